@@ -19,15 +19,20 @@ struct brushed_motor_data {
     int in1_pin;            
     int in2_pin;
 
+    pwm_engine pwm;     /* Generates the pwm on the enable pin. */
+    int pwm_channel;    /* The pwm engine's channel for the enable pin. */
+
     int duty_cycle;     /* The duty cycle of the motor. */
     int duty_cycle_max; /* The maximum possible duty cycle of the motor. */
 };
 
 /**
- * This function initialises the brushed motor provided to it.
+ * This function initialises the brushed motor provided to it. The motor's
+ * enable pin is driven by a channel of the pwm engine provided to it.
  */
-void brushed_motor_init(brushed_motor* bmp, int duty_cycle_max, int en_pin,
-                                            int in1_pin, int in2_pin)
+void brushed_motor_init(brushed_motor* bmp, pwm_engine* pp,
+                        int duty_cycle_max, int en_pin,
+                        int in1_pin, int in2_pin)
 {
     /* Initialise properties. */
     *bmp = (brushed_motor) malloc(sizeof(struct brushed_motor_data));
@@ -38,14 +43,27 @@ void brushed_motor_init(brushed_motor* bmp, int duty_cycle_max, int en_pin,
     (*bmp)->in2_pin = in2_pin;
 
     /* Configure rpi pins so they can communicate with this motor's driver. */
-    setup_gpio((*bmp)->en_pin, OUTPUT, 0);
-    setup_gpio((*bmp)->in1_pin, OUTPUT, 0);
-    setup_gpio((*bmp)->in2_pin, OUTPUT, 0);
-
-    /* Initialise PWM. */
-    pwm_set_duty_cycle((*bmp)->en_pin, (*bmp)->duty_cycle);
-    pwm_set_frequency((*bmp)->en_pin, 480);
-    pwm_start((*bmp)->en_pin);
+    gpio_setup_pin((*bmp)->in1_pin, OUTPUT, 0);
+    gpio_setup_pin((*bmp)->in2_pin, OUTPUT, 0);
+
+    /* Initialise PWM. The enable pin is only an ordinary output if it is
+     * driven by software, as hardware pwm needs the pin in its alternate
+     * function. */
+    (*bmp)->pwm = *pp;
+    (*bmp)->pwm_channel = pwm_engine_add_channel(pp, (*bmp)->en_pin);
+    if (!pwm_engine_is_hardware(*pp, (*bmp)->pwm_channel))
+        gpio_setup_pin((*bmp)->en_pin, OUTPUT, 0);
+}
+
+/**
+ * This function applies the duty cycle of the motor provided to it to the
+ * motor's enable pin.
+ */
+void apply_duty_cycle(brushed_motor* bmp)
+{
+    pwm_engine_set_duty_cycle(&(*bmp)->pwm, (*bmp)->pwm_channel,
+                              abs((*bmp)->duty_cycle) * 100
+                                / (*bmp)->duty_cycle_max);
 }
 
 /**
@@ -53,8 +71,11 @@ void brushed_motor_init(brushed_motor* bmp, int duty_cycle_max, int en_pin,
  */
 void brushed_motor_term(brushed_motor* bmp)
 {
-    /* Stop the PWM instance. */
-    pwm_stop((*bmp)->en_pin);
+    /* Stop driving the motor. */
+    (*bmp)->duty_cycle = 0;
+    apply_duty_cycle(bmp);
+    gpio_output((*bmp)->in1_pin, LOW);
+    gpio_output((*bmp)->in2_pin, LOW);
 
     /* De-allocate memory from the brushed_motor. */
     free(*bmp);
@@ -75,8 +96,8 @@ int brushed_motor_get_duty_cycle(brushed_motor bm)
 void forwards(int bcm1, int bcm2)
 {
     /* Putting the motor into a state of forwards rotation. */
-    output_gpio(bcm1, HIGH);
-    output_gpio(bcm2, LOW);
+    gpio_output(bcm1, HIGH);
+    gpio_output(bcm2, LOW);
 }
 
 /**
@@ -86,8 +107,8 @@ void forwards(int bcm1, int bcm2)
 void backwards(int bcm1, const int bcm2)
 {
     /* Putting the motor into a state of backwards rotation. */
-    output_gpio(bcm1, LOW);
-    output_gpio(bcm2, HIGH);
+    gpio_output(bcm1, LOW);
+    gpio_output(bcm2, HIGH);
 }
 
 /**
@@ -97,45 +118,31 @@ void backwards(int bcm1, const int bcm2)
 void stop(int bcm1, int bcm2)
 {
     /* Putting the motor into a stopped state. */
-    output_gpio(bcm1, LOW);
-    output_gpio(bcm2, LOW);
+    gpio_output(bcm1, LOW);
+    gpio_output(bcm2, LOW);
 }
 
 /**
- * This function changes the duty cycle of the provided motor.
+ * This function sets the duty cycle of the provided motor. A negative duty
+ * cycle makes the motor spin backwards.
  */
-void brushed_motor_change_duty_cycle( brushed_motor* bmp, int delta )
+void brushed_motor_set_duty_cycle(brushed_motor* bmp, int duty_cycle)
 {
-    int duty_cycle;  /* The duty-cycle of the motor. */
-
-    /* Calculating the new duty-cycle. */
-    (*bmp)->duty_cycle += delta;
-
     /* Ensuring the duty-cycle is limited by the maximum possible value. */
-    if ((*bmp)->duty_cycle > (*bmp)->duty_cycle_max) 
-        (*bmp)->duty_cycle = (*bmp)->duty_cycle_max;
-    else if ((*bmp)->duty_cycle < -(*bmp)->duty_cycle_max) 
-        (*bmp)->duty_cycle = -(*bmp)->duty_cycle_max;
+    if (duty_cycle > (*bmp)->duty_cycle_max)
+        duty_cycle = (*bmp)->duty_cycle_max;
+    else if (duty_cycle < -(*bmp)->duty_cycle_max)
+        duty_cycle = -(*bmp)->duty_cycle_max;
+    (*bmp)->duty_cycle = duty_cycle;
 
     /* Ensuring that the motor is spinning in the correct direction. */
-    if (delta > 0 && (*bmp)->duty_cycle >= 0)
-    {
+    if (duty_cycle > 0)
         forwards((*bmp)->in1_pin, (*bmp)->in2_pin);
-    }
-    else if (delta < 0 && (*bmp)->duty_cycle <= 0)
-    {
+    else if (duty_cycle < 0)
         backwards((*bmp)->in1_pin, (*bmp)->in2_pin);
-    }
-    else if (delta == 0)
-    {
+    else
         stop((*bmp)->in1_pin, (*bmp)->in2_pin);
-        (*bmp)->duty_cycle = delta;
-    }
 
     /* Applying the duty-cycle to the motor. */
-    if ((*bmp)->duty_cycle < 0)
-        duty_cycle = -(*bmp)->duty_cycle;
-    else
-        duty_cycle = (*bmp)->duty_cycle;
-    pwm_set_duty_cycle((*bmp)->en_pin, duty_cycle);
+    apply_duty_cycle(bmp);
 }
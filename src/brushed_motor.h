@@ -12,7 +12,20 @@
 #define brushed_motor_h
 
 #include <stdlib.h>
-#include <pi-gpio.h>
+
+#include "gpio.h"
+#include "pwm_engine.h"
+
+/**
+ * This is the calibration of a brushed motor. The speed of its wheel is
+ * zero up to the deadband duty cycle, then rises to max_speed at the
+ * maximum duty cycle along a curve with the exponent gamma.
+ */
+typedef struct {
+    int deadband;   /* The duty cycle the wheel starts turning at. */
+    int max_speed;  /* The wheel speed at the maximum duty cycle, mm/s. */
+    double gamma;   /* The shape of the curve in between. */
+} motor_calibration;
 
 /**
  * This is the data-structure of the brushed_motor type.
@@ -20,10 +33,12 @@
 typedef struct brushed_motor_data* brushed_motor;
 
 /**
- * This function initialises the brushed motor provided to it.
+ * This function initialises the brushed motor provided to it. The motor's
+ * enable pin is driven by a channel of the pwm engine provided to it.
  */
-void brushed_motor_init(brushed_motor* bmp, int duty_cycle_max, int en_pin,
-                                            int in1_pin, int in2_pin);
+void brushed_motor_init(brushed_motor* bmp, pwm_engine* pp,
+                        int duty_cycle_max, int en_pin,
+                        int in1_pin, int in2_pin);
 
 /**
  * This function terminates the brushed motor provided to it.
@@ -36,8 +51,9 @@ void brushed_motor_term(brushed_motor* bmp);
 int brushed_motor_get_duty_cycle(brushed_motor bm);
 
 /**
- * Alters the duty-cycle of the provided motor.
+ * This function sets the duty cycle of the provided motor. A negative duty
+ * cycle makes the motor spin backwards.
  */
-void brushed_motor_change_duty_cycle( brushed_motor* bmp, int delta );
+void brushed_motor_set_duty_cycle(brushed_motor* bmp, int duty_cycle);
 
 #endif
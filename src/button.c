@@ -35,12 +35,12 @@ void button_init(button* bp, int pin, int mode)
     *bp = (button) malloc(sizeof(struct button_data));
 
     /* Set up the raspberry pi gpio pin that corresponds with the button. */
-    setup_gpio((*bp)->pin, INPUT, mode);
+    gpio_setup_pin(pin, INPUT, mode);
 
     /* Initialise the buttons internal data. */
     (*bp)->pin = pin;
     (*bp)->debounce_time = 0;
-	(*bp)->previous_steady_state = input_gpio(pin);
+	(*bp)->previous_steady_state = gpio_input(pin);
 	(*bp)->last_steady_state = (*bp)->previous_steady_state;
 	(*bp)->last_flickerable_state = (*bp)->previous_steady_state;
 	start_timer(&(*bp)->last_debounce_time);
@@ -77,7 +77,7 @@ int button_get_state(button b)
  */
 int button_get_state_raw(button b)
 {
-	return input_gpio(b->pin);
+	return gpio_input(b->pin);
 }
 
 /**
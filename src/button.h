@@ -6,8 +6,8 @@
 #include <stdbool.h>
 #include <time.h>
 #include <stdint.h>
-#include <pi-gpio.h>
 
+#include "gpio.h"
 #include "mycutils.h"
 
 /**
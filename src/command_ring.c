@@ -0,0 +1,202 @@
+/**
+ * command_ring.c
+ *
+ * This file contains the internal data-structure and function definitions
+ * for the command_ring type.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#include "command_ring.h"
+
+/* This is the size of a cache line. The two ends of a lane are kept on
+ * separate lines so the producer and consumer don't fight over them. */
+#define CACHE_LINE_SIZE 64
+
+/**
+ * This is one lane of a command ring. The producer only writes tail and
+ * the consumer only writes head.
+ */
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t head;   /* The next to pop. */
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t tail;   /* The next to push. */
+    _Alignas(CACHE_LINE_SIZE) command_record records[COMMAND_RING_CAPACITY];
+} command_lane;
+
+/**
+ * These are the latency statistics of one key.
+ */
+typedef struct {
+    uint64_t count;     /* The number of commands executed. */
+    uint64_t total;     /* The sum of their latencies. */
+    uint64_t worst;     /* The largest latency. */
+} command_stats;
+
+/**
+ * This is the internal data-structure of the command_ring type.
+ */
+struct command_ring_data {
+    command_lane normal;            /* Ordinary commands. */
+    command_lane priority;          /* Commands that jump the queue. */
+    uint64_t num_dropped;           /* Commands a stop made stale. */
+    command_stats stats[256];       /* The statistics of every key. */
+};
+
+/**
+ * This function queues the record provided to it in the lane provided to
+ * it, and returns false if the lane is full.
+ */
+bool lane_push(command_lane* lane, command_record rec)
+{
+    size_t tail;    /* Where the record goes. */
+
+    tail = atomic_load_explicit(&lane->tail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&lane->head, memory_order_acquire)
+        == COMMAND_RING_CAPACITY)
+        return false;
+    lane->records[tail % COMMAND_RING_CAPACITY] = rec;
+    atomic_store_explicit(&lane->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * This function copies the oldest record in the lane provided to it into
+ * recp without taking it, and returns false if the lane is empty.
+ */
+bool lane_peek(command_lane* lane, command_record* recp)
+{
+    size_t head;    /* Where the oldest record is. */
+
+    head = atomic_load_explicit(&lane->head, memory_order_relaxed);
+    if (head == atomic_load_explicit(&lane->tail, memory_order_acquire))
+        return false;
+    *recp = lane->records[head % COMMAND_RING_CAPACITY];
+    return true;
+}
+
+/**
+ * This function drops the oldest record in the lane provided to it, which
+ * must have been peeked.
+ */
+void lane_drop(command_lane* lane)
+{
+    atomic_store_explicit(&lane->head,
+        atomic_load_explicit(&lane->head, memory_order_relaxed) + 1,
+        memory_order_release);
+}
+
+/**
+ * This function initialises the command ring provided to it.
+ */
+void command_ring_init(command_ring* cp)
+{
+    /* Allocate memory to the command ring, aligned so its lanes' ends sit
+     * on their own cache lines. */
+    *cp = (command_ring) aligned_alloc(CACHE_LINE_SIZE,
+        (sizeof(struct command_ring_data) + CACHE_LINE_SIZE - 1)
+        / CACHE_LINE_SIZE * CACHE_LINE_SIZE);
+
+    /* Start empty. */
+    atomic_init(&(*cp)->normal.head, 0);
+    atomic_init(&(*cp)->normal.tail, 0);
+    atomic_init(&(*cp)->priority.head, 0);
+    atomic_init(&(*cp)->priority.tail, 0);
+    (*cp)->num_dropped = 0;
+    memset((*cp)->stats, 0, sizeof((*cp)->stats));
+}
+
+/**
+ * This function terminates the command ring provided to it.
+ */
+void command_ring_term(command_ring* cp)
+{
+    /* De-allocate memory from the command ring. */
+    free(*cp);
+}
+
+/**
+ * This function queues a command for the key provided to it, timestamped
+ * now. Priority commands go in their own lane, which is emptied first. It
+ * returns false if the lane is full. Only one thread may push.
+ */
+bool command_ring_push(command_ring* cp, char key, bool priority)
+{
+    command_record rec = { key, monotonic_nanos() };
+
+    return lane_push(priority ? &(*cp)->priority : &(*cp)->normal, rec);
+}
+
+/**
+ * This function takes the next command from the command ring provided to
+ * it and returns true, or returns false if there isn't one. Taking a
+ * priority command discards every ordinary command queued before it. Only
+ * one thread may pop.
+ */
+bool command_ring_pop(command_ring* cp, command_record* recp)
+{
+    command_record stale;   /* An ordinary command queued before a stop. */
+
+    /* Priority commands go first, and make anything queued before them
+     * stale. */
+    if (lane_peek(&(*cp)->priority, recp))
+    {
+        lane_drop(&(*cp)->priority);
+        while (lane_peek(&(*cp)->normal, &stale)
+               && stale.enqueued <= recp->enqueued)
+        {
+            lane_drop(&(*cp)->normal);
+            (*cp)->num_dropped++;
+        }
+        return true;
+    }
+
+    /* Then ordinary commands, in order. */
+    if (lane_peek(&(*cp)->normal, recp))
+    {
+        lane_drop(&(*cp)->normal);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * This function records that the command provided to it has just been
+ * executed, adding its latency to the statistics for its key. Only the
+ * popping thread may record.
+ */
+void command_ring_record_latency(command_ring* cp, command_record rec)
+{
+    command_stats* s;   /* The statistics of the command's key. */
+    uint64_t latency;   /* The time from queueing to now. */
+
+    s = &(*cp)->stats[(unsigned char) rec.key];
+    latency = monotonic_nanos() - rec.enqueued;
+    s->count++;
+    s->total += latency;
+    if (latency > s->worst)
+        s->worst = latency;
+}
+
+/**
+ * This function prints the latency statistics of the command ring provided
+ * to it to the stream provided to it.
+ */
+void command_ring_print_stats(command_ring c, FILE* fp)
+{
+    command_stats* s;   /* The statistics of a key. */
+    int key;
+
+    for (key = 0; key < 256; key++)
+    {
+        s = &c->stats[key];
+        if (s->count == 0)
+            continue;
+        fprintf(fp, " - Command '%c': %llu run, mean %.3f ms, worst %.3f ms\n",
+                key, (unsigned long long) s->count,
+                (double) s->total / s->count / 1e6, s->worst / 1e6);
+    }
+    fprintf(fp, " - Commands dropped by stops: %llu\n",
+            (unsigned long long) c->num_dropped);
+}
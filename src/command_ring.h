@@ -0,0 +1,79 @@
+/*
+ * command_ring.h
+ *
+ * This file contains the public data-structure and public function prototype
+ * declarations for the command_ring type, a lock-free queue that carries
+ * timestamped commands from one producer thread to one consumer thread.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#ifndef command_ring_h
+#define command_ring_h
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "mycutils.h"
+
+/* This is the number of records each lane of a command ring holds. It must
+ * be a power of two. */
+#define COMMAND_RING_CAPACITY 64
+
+/**
+ * This is a command waiting in a command ring.
+ */
+typedef struct {
+    char key;           /* The key the command came from. */
+    uint64_t enqueued;  /* When it was queued, in monotonic nanoseconds. */
+} command_record;
+
+/**
+ * This is the data-structure of the command_ring type.
+ */
+typedef struct command_ring_data* command_ring;
+
+/**
+ * This function initialises the command ring provided to it.
+ */
+void command_ring_init(command_ring* cp);
+
+/**
+ * This function terminates the command ring provided to it.
+ */
+void command_ring_term(command_ring* cp);
+
+/**
+ * This function queues a command for the key provided to it, timestamped
+ * now. Priority commands go in their own lane, which is emptied first. It
+ * returns false if the lane is full. Only one thread may push.
+ */
+bool command_ring_push(command_ring* cp, char key, bool priority);
+
+/**
+ * This function takes the next command from the command ring provided to
+ * it and returns true, or returns false if there isn't one. Taking a
+ * priority command discards every ordinary command queued before it. Only
+ * one thread may pop.
+ */
+bool command_ring_pop(command_ring* cp, command_record* recp);
+
+/**
+ * This function records that the command provided to it has just been
+ * executed, adding its latency to the statistics for its key. Only the
+ * popping thread may record.
+ */
+void command_ring_record_latency(command_ring* cp, command_record rec);
+
+/**
+ * This function prints the latency statistics of the command ring provided
+ * to it to the stream provided to it.
+ */
+void command_ring_print_stats(command_ring c, FILE* fp);
+
+#endif
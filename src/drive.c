@@ -14,11 +14,55 @@
  * This is the internal data of the drive type.
  */
 struct drive_data {
+    pwm_engine pwm;         /* Generates the pwm for both motors. */
     brushed_motor lmotor;   /* The drive's left motor. */
     brushed_motor rmotor;   /* The drive's right motor. */
-    int acceleration_rate;  /* The drive's rate of acceleration. */
+    int acceleration_rate;  /* How much a command changes the targets. */
+    int ltarget;            /* The left motor's target duty cycle. */
+    int rtarget;            /* The right motor's target duty cycle. */
+    int accel_rate;         /* The most a duty cycle can speed up a tick. */
+    int brake_rate;         /* The most a duty cycle can slow down a tick. */
+
+    /* These turn wheel speeds into the duty cycles of the left and right
+     * motors, one entry every DRIVE_SPEED_STEP millimetres per second. */
+    int lduty_table[DRIVE_SPEED_ENTRIES];
+    int rduty_table[DRIVE_SPEED_ENTRIES];
+
+    odometry o;             /* Estimates where the drive has gone. */
+
+    /* This stops a halt from the emergency stop's thread racing an update
+     * on the drive's worker. It guards the targets and duty cycles. */
+    pthread_mutex_t lock;
 };
 
+/**
+ * This function fills the table provided to it with the duty cycles that
+ * make a motor with the calibration provided to it reach every wheel
+ * speed in the table.
+ */
+void build_duty_table(int* table, motor_calibration cal)
+{
+    double fraction;    /* The fraction of the motor's maximum speed. */
+    int e;
+
+    for (e = 0; e < DRIVE_SPEED_ENTRIES; e++)
+    {
+        /* A wheel that isn't moving doesn't need any power. */
+        if (e == 0)
+        {
+            table[e] = 0;
+            continue;
+        }
+
+        /* Invert the calibration curve. */
+        fraction = (double) (e * DRIVE_SPEED_STEP) / cal.max_speed;
+        if (fraction > 1)
+            fraction = 1;
+        table[e] = (int) lround(cal.deadband
+            + (DRIVE_DUTY_CYCLE_MAX - cal.deadband) * pow(fraction, 1 / cal.gamma));
+    }
+}
+
 /**
  * This function initialises the drive provided to it.
  */
@@ -27,10 +71,28 @@ void drive_init(drive* dp)
     /* Allocate memory to the drive. */
     *dp = (drive) malloc(sizeof(struct drive_data));
 
-    /* Initialise motors. */
-    brushed_motor_init(&(*dp)->lmotor, 100, 12, 17, 27);
-    brushed_motor_init(&(*dp)->rmotor, 100, 13, 5, 6);
-    (*dp)->acceleration_rate = 25;
+    /* Initialise motors, with one pwm engine driving both of them. */
+    pwm_engine_init(&(*dp)->pwm, DRIVE_PWM_FREQUENCY);
+    brushed_motor_init(&(*dp)->lmotor, &(*dp)->pwm, DRIVE_DUTY_CYCLE_MAX,
+                       12, 17, 27);
+    brushed_motor_init(&(*dp)->rmotor, &(*dp)->pwm, DRIVE_DUTY_CYCLE_MAX,
+                       13, 5, 6);
+    (*dp)->acceleration_rate = DRIVE_COMMAND_STEP;
+
+    /* Start with the motors stopped. */
+    (*dp)->ltarget = 0;
+    (*dp)->rtarget = 0;
+    (*dp)->accel_rate = DRIVE_ACCEL_RATE;
+    (*dp)->brake_rate = DRIVE_BRAKE_RATE;
+    pthread_mutex_init(&(*dp)->lock, NULL);
+
+    /* Start estimating where the drive goes. */
+    odometry_init(&(*dp)->o, DRIVE_DUTY_CYCLE_MAX, DRIVE_TRACK_WIDTH,
+                  DRIVE_LMOTOR_CALIBRATION, DRIVE_RMOTOR_CALIBRATION);
+
+    /* Build the tables that turn wheel speeds into duty cycles. */
+    drive_set_calibration(dp, DRIVE_LMOTOR_CALIBRATION,
+                              DRIVE_RMOTOR_CALIBRATION);
 }
 
 /**
@@ -41,6 +103,11 @@ void drive_term(drive* dp)
     /* Terminating the motors. */
     brushed_motor_term(&(*dp)->lmotor);
     brushed_motor_term(&(*dp)->rmotor);
+    pwm_engine_term(&(*dp)->pwm);
+
+    /* Stop estimating where the drive goes. */
+    odometry_term(&(*dp)->o);
+    pthread_mutex_destroy(&(*dp)->lock);
 
     /* De-allocating memory from the drive. */
     free(*dp);
@@ -64,50 +131,215 @@ int drive_get_rmotor_duty_cycle(drive d)
     return brushed_motor_get_duty_cycle(d->rmotor);
 }
 
+/**
+ * This function sets the amounts the duty cycles of the motors of the drive
+ * provided to it can move towards their targets every update, when
+ * speeding up and when slowing down.
+ */
+void drive_set_slew_rates(drive* dp, int accel_rate, int brake_rate)
+{
+    (*dp)->accel_rate = accel_rate;
+    (*dp)->brake_rate = brake_rate;
+}
+
+/**
+ * This function sets the calibrations of the motors of the drive provided
+ * to it, and rebuilds the tables that turn wheel speeds into duty cycles.
+ */
+void drive_set_calibration(drive* dp, motor_calibration lcal,
+                                      motor_calibration rcal)
+{
+    build_duty_table((*dp)->lduty_table, lcal);
+    build_duty_table((*dp)->rduty_table, rcal);
+    odometry_set_calibration(&(*dp)->o, lcal, rcal);
+}
+
+/**
+ * This function returns the estimated pose of the drive provided to it.
+ */
+odometry_pose drive_get_pose(drive d)
+{
+    return odometry_get_pose(d->o);
+}
+
+/**
+ * This function returns the duty cycle the table provided to it gives for
+ * a wheel speed in millimetres per second.
+ */
+int lookup_duty_cycle(int* table, int speed)
+{
+    int entry;  /* The entry of the table nearest the speed. */
+
+    /* Find the nearest entry. */
+    entry = (abs(speed) + DRIVE_SPEED_STEP / 2) / DRIVE_SPEED_STEP;
+    if (entry >= DRIVE_SPEED_ENTRIES)
+        entry = DRIVE_SPEED_ENTRIES - 1;
+
+    /* Wheels going backwards need negative duty cycles. */
+    return speed < 0 ? -table[entry] : table[entry];
+}
+
+/**
+ * This function makes the drive provided to it move at the linear velocity
+ * v, in millimetres per second, while turning at the yaw rate w, in
+ * milliradians per second anticlockwise. If a wheel would have to go
+ * faster than DRIVE_MAX_SPEED both wheels are slowed down by the same
+ * proportion, so the rover still follows the same arc.
+ */
+void drive_set_velocity(drive* dp, int v, int w)
+{
+    long lspeed;    /* The speed of the left wheel. */
+    long rspeed;    /* The speed of the right wheel. */
+    long fastest;   /* The speed of the fastest wheel. */
+
+    /* Work out the speed of each wheel. */
+    lspeed = v - (long) w * (DRIVE_TRACK_WIDTH / 2) / 1000;
+    rspeed = v + (long) w * (DRIVE_TRACK_WIDTH / 2) / 1000;
+
+    /* Slow both wheels down if either is too fast. */
+    fastest = labs(lspeed) > labs(rspeed) ? labs(lspeed) : labs(rspeed);
+    if (fastest > DRIVE_MAX_SPEED)
+    {
+        lspeed = lspeed * DRIVE_MAX_SPEED / fastest;
+        rspeed = rspeed * DRIVE_MAX_SPEED / fastest;
+    }
+
+    /* Aim the motors at the duty cycles for those speeds. */
+    pthread_mutex_lock(&(*dp)->lock);
+    (*dp)->ltarget = lookup_duty_cycle((*dp)->lduty_table, lspeed);
+    (*dp)->rtarget = lookup_duty_cycle((*dp)->rduty_table, rspeed);
+    pthread_mutex_unlock(&(*dp)->lock);
+}
+
+/**
+ * This function changes the target duty cycle provided to it by delta,
+ * keeping it within the motors' limits.
+ */
+void change_target(int* target, int delta)
+{
+    *target += delta;
+    if (*target > DRIVE_DUTY_CYCLE_MAX)
+        *target = DRIVE_DUTY_CYCLE_MAX;
+    else if (*target < -DRIVE_DUTY_CYCLE_MAX)
+        *target = -DRIVE_DUTY_CYCLE_MAX;
+}
+
+/**
+ * This function returns the duty cycle a motor should have after one more
+ * update, given its duty cycle and target. Slowing down uses the brake
+ * rate and speeding up the acceleration rate. A motor that has to change
+ * direction brakes to a stop first.
+ */
+int slew(int duty_cycle, int target, int accel_rate, int brake_rate)
+{
+    /* Slow down a motor that is spinning forwards. */
+    if (duty_cycle > 0 && target < duty_cycle)
+    {
+        duty_cycle -= brake_rate;
+        if (duty_cycle < (target > 0 ? target : 0))
+            duty_cycle = target > 0 ? target : 0;
+    }
+
+    /* Slow down a motor that is spinning backwards. */
+    else if (duty_cycle < 0 && target > duty_cycle)
+    {
+        duty_cycle += brake_rate;
+        if (duty_cycle > (target < 0 ? target : 0))
+            duty_cycle = target < 0 ? target : 0;
+    }
+
+    /* Speed up the motor forwards. */
+    else if (target > duty_cycle)
+    {
+        duty_cycle += accel_rate;
+        if (duty_cycle > target)
+            duty_cycle = target;
+    }
+
+    /* Speed up the motor backwards. */
+    else if (target < duty_cycle)
+    {
+        duty_cycle -= accel_rate;
+        if (duty_cycle < target)
+            duty_cycle = target;
+    }
+
+    return duty_cycle;
+}
+
+/**
+ * This function stops the motors of the drive provided to it straight away.
+ * It is called by the input watcher when a stop key is pressed, so it takes
+ * a pointer to the drive as a void pointer.
+ */
+void drive_halt(void* dp)
+{
+    drive d = *(drive*) dp; /* The drive. */
+
+    /* Wait for any update to finish, so it can't put the duty cycles
+     * back. */
+    pthread_mutex_lock(&d->lock);
+    d->ltarget = 0;
+    d->rtarget = 0;
+    brushed_motor_set_duty_cycle(&d->lmotor, 0);
+    brushed_motor_set_duty_cycle(&d->rmotor, 0);
+
+    /* Account for the movement up to the halt, so the next update doesn't
+     * carry on at the old duty cycles past it. */
+    odometry_update(&d->o, 0, 0);
+    pthread_mutex_unlock(&d->lock);
+}
+
 /**
  * This function updates the drive provided to it.
  */
 void drive_update(drive* dp, enum DriveCommand drive_command)
 {
+    pthread_mutex_lock(&(*dp)->lock);
+
+    /* Keep the motors stopped while the rover is halted. */
+    if (estop_is_halted())
+        drive_command = STOP_DRIVE;
+
     /* Checking the drive command. */
     switch (drive_command)
     {
         /* Make both motors go faster. */
         case ACCELERATE :
-            brushed_motor_change_duty_cycle(&(*dp)->lmotor,
-                                            (*dp)->acceleration_rate);
-            brushed_motor_change_duty_cycle(&(*dp)->rmotor,
-                                            (*dp)->acceleration_rate);
+            change_target(&(*dp)->ltarget, (*dp)->acceleration_rate);
+            change_target(&(*dp)->rtarget, (*dp)->acceleration_rate);
             break;
         
         /* Make both motors go slower. */
         case DECELERATE :
-            brushed_motor_change_duty_cycle(&(*dp)->lmotor,
-                                            -(*dp)->acceleration_rate);
-            brushed_motor_change_duty_cycle(&(*dp)->rmotor,
-                                            -(*dp)->acceleration_rate);
+            change_target(&(*dp)->ltarget, -(*dp)->acceleration_rate);
+            change_target(&(*dp)->rtarget, -(*dp)->acceleration_rate);
             break;
 
         /* Make the left motor go slower and the right faster. */
         case TURN_LEFT :
-            brushed_motor_change_duty_cycle(&(*dp)->lmotor,
-                                            -(*dp)->acceleration_rate);
-            brushed_motor_change_duty_cycle(&(*dp)->rmotor,
-                                            (*dp)->acceleration_rate);
+            change_target(&(*dp)->ltarget, -(*dp)->acceleration_rate);
+            change_target(&(*dp)->rtarget, (*dp)->acceleration_rate);
             break;
 
         /* Make the right motor go slower and the left faster. */
         case TURN_RIGHT :
-            brushed_motor_change_duty_cycle(&(*dp)->lmotor,
-                                            (*dp)->acceleration_rate);
-            brushed_motor_change_duty_cycle(&(*dp)->rmotor,
-                                            -(*dp)->acceleration_rate);
+            change_target(&(*dp)->ltarget, (*dp)->acceleration_rate);
+            change_target(&(*dp)->rtarget, -(*dp)->acceleration_rate);
             break;
 
-        /* Make the motors stop. */
+        /* Slow the motors down to a stop. */
+        case BRAKE :
+            (*dp)->ltarget = 0;
+            (*dp)->rtarget = 0;
+            break;
+
+        /* Make the motors stop immediately, bypassing the brake rate. */
         case STOP_DRIVE :
-            brushed_motor_change_duty_cycle(&(*dp)->lmotor, 0);
-            brushed_motor_change_duty_cycle(&(*dp)->rmotor, 0);
+            (*dp)->ltarget = 0;
+            (*dp)->rtarget = 0;
+            brushed_motor_set_duty_cycle(&(*dp)->lmotor, 0);
+            brushed_motor_set_duty_cycle(&(*dp)->rmotor, 0);
             break;
 
         /* Do nothing. */
@@ -115,4 +347,18 @@ void drive_update(drive* dp, enum DriveCommand drive_command)
             NULL;
             break;
     }
+
+    /* Move the motors' duty cycles towards their targets. */
+    brushed_motor_set_duty_cycle(&(*dp)->lmotor,
+        slew(brushed_motor_get_duty_cycle((*dp)->lmotor), (*dp)->ltarget,
+             (*dp)->accel_rate, (*dp)->brake_rate));
+    brushed_motor_set_duty_cycle(&(*dp)->rmotor,
+        slew(brushed_motor_get_duty_cycle((*dp)->rmotor), (*dp)->rtarget,
+             (*dp)->accel_rate, (*dp)->brake_rate));
+
+    /* Account for how the drive moved since the last update. */
+    odometry_update(&(*dp)->o, brushed_motor_get_duty_cycle((*dp)->lmotor),
+                               brushed_motor_get_duty_cycle((*dp)->rmotor));
+
+    pthread_mutex_unlock(&(*dp)->lock);
 }
@@ -12,8 +12,12 @@
 #define drive_h
 
 #include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
 
 #include "brushed_motor.h"
+#include "odometry.h"
+#include "estop.h"
 
 /**
  * These are the commands that can be sent to the drive.
@@ -24,9 +28,44 @@ enum DriveCommand {
     DECELERATE,         /* Make both motors go slower. */
     TURN_LEFT,          /* Make the left motor go slower and the right faster. */
     TURN_RIGHT,         /* Make the right motor go slower and the left faster. */
-    STOP_DRIVE          /* Stop the motors. */
+    BRAKE,              /* Slow both motors down to a stop. */
+    STOP_DRIVE          /* Stop the motors immediately. */
 };
 
+/* This is the maximum duty cycle of the drive's motors. */
+#define DRIVE_DUTY_CYCLE_MAX 100
+
+/* This is how much a command changes the target duty cycles of the
+ * drive's motors by. */
+#define DRIVE_COMMAND_STEP 25
+
+/* This is the frequency of the pwm driving the motors, in hertz. */
+#define DRIVE_PWM_FREQUENCY 480
+
+/* This is the distance, in millimetres, between the drive's wheels. */
+#define DRIVE_TRACK_WIDTH 200
+
+/* This is the fastest, in millimetres per second, a wheel is commanded to
+ * go. */
+#define DRIVE_MAX_SPEED 400
+
+/* This is the width, in millimetres per second, of each entry in the
+ * tables that turn wheel speeds into duty cycles. */
+#define DRIVE_SPEED_STEP 5
+
+/* This is the number of entries in each of those tables. */
+#define DRIVE_SPEED_ENTRIES (DRIVE_MAX_SPEED / DRIVE_SPEED_STEP + 1)
+
+/* These are the default calibrations of the left and right motors. */
+#define DRIVE_LMOTOR_CALIBRATION ((motor_calibration) { 20, 450, 0.8 })
+#define DRIVE_RMOTOR_CALIBRATION ((motor_calibration) { 20, 450, 0.8 })
+
+/* These are the default amounts the duty cycle of a motor can move towards
+ * its target every update of the drive, when speeding up and when slowing
+ * down. */
+#define DRIVE_ACCEL_RATE 10
+#define DRIVE_BRAKE_RATE 25
+
 /**
  * This is the data-structure of the drive type.
  */
@@ -54,6 +93,41 @@ int drive_get_lmotor_duty_cycle(drive d);
  */
 int drive_get_rmotor_duty_cycle(drive d);
 
+/**
+ * This function sets the amounts the duty cycles of the motors of the drive
+ * provided to it can move towards their targets every update, when
+ * speeding up and when slowing down.
+ */
+void drive_set_slew_rates(drive* dp, int accel_rate, int brake_rate);
+
+/**
+ * This function sets the calibrations of the motors of the drive provided
+ * to it, and rebuilds the tables that turn wheel speeds into duty cycles.
+ */
+void drive_set_calibration(drive* dp, motor_calibration lcal,
+                                      motor_calibration rcal);
+
+/**
+ * This function makes the drive provided to it move at the linear velocity
+ * v, in millimetres per second, while turning at the yaw rate w, in
+ * milliradians per second anticlockwise. If a wheel would have to go
+ * faster than DRIVE_MAX_SPEED both wheels are slowed down by the same
+ * proportion, so the rover still follows the same arc.
+ */
+void drive_set_velocity(drive* dp, int v, int w);
+
+/**
+ * This function returns the estimated pose of the drive provided to it.
+ */
+odometry_pose drive_get_pose(drive d);
+
+/**
+ * This function stops the motors of the drive provided to it straight away.
+ * It is called by the input watcher when a stop key is pressed, so it takes
+ * a pointer to the drive as a void pointer.
+ */
+void drive_halt(void* dp);
+
 /**
  * This function updates the drive provided to it.
  */
@@ -0,0 +1,227 @@
+/**
+ * estop.c
+ *
+ * This file contains the internal data-structure and function definitions
+ * for the estop type.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#include "estop.h"
+
+/**
+ * This is whether the rover has been halted. It is shared with every long
+ * motion, whichever thread it runs on.
+ */
+atomic_bool estop_halted = false;
+
+/**
+ * This is the internal data-structure of the estop type.
+ */
+struct estop_data {
+    void (*halt)(void*);    /* Stops the motors. */
+    void* arg;              /* Passed to the halt function. */
+    atomic_bool quit_armed; /* Whether the quit key stops the motors. */
+
+    pthread_t thread;       /* The input watcher. */
+    atomic_bool running;    /* Whether the input watcher should keep going. */
+    struct termios saved;   /* The terminal's settings before the watcher. */
+    command_ring commands;  /* Where the watcher queues the keys. */
+
+    /* These are the latencies of the stops. */
+    pthread_mutex_t stats_lock;
+    unsigned num_stops;
+    uint64_t last_latency;
+    uint64_t worst_latency;
+};
+
+/**
+ * This function returns the nanoseconds between the two times provided to
+ * it.
+ */
+uint64_t nanos_between(struct timespec start, struct timespec end)
+{
+    return (uint64_t) (end.tv_sec - start.tv_sec) * NANOS_PER_SEC
+        + end.tv_nsec - start.tv_nsec;
+}
+
+/**
+ * This function is run by the input watcher of the estop provided to it. It
+ * stops the motors the moment a stop key is read, then passes every key on
+ * to the frame loop.
+ */
+void* estop_watch(void* arg)
+{
+    estop e;                    /* The estop being run. */
+    struct pollfd in;           /* Waits for the user's input. */
+    struct timespec pressed;    /* When the key was read. */
+    struct timespec stopped;    /* When the motors were stopped. */
+    uint64_t latency;           /* The time it took to stop. */
+    char key;                   /* The key that was pressed. */
+    bool is_stop;               /* Whether the key stops the motors. */
+
+    e = (estop) arg;
+    in.fd = 0;
+    in.events = POLLIN;
+
+    while (atomic_load(&e->running))
+    {
+        /* Wait for a key. */
+        if (poll(&in, 1, ESTOP_POLL_MILLIS) <= 0)
+            continue;
+
+        /* Don't spin if the input has been closed. */
+        if (read(0, &key, 1) != 1)
+        {
+            usleep(ESTOP_POLL_MILLIS * 1000);
+            continue;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &pressed);
+
+        /* Stop the motors straight away if it's a stop key. */
+        is_stop = key == ESTOP_STOP_KEY
+            || (key == ESTOP_QUIT_KEY && atomic_load(&e->quit_armed));
+        if (is_stop)
+        {
+            atomic_store(&estop_halted, true);
+            e->halt(e->arg);
+            clock_gettime(CLOCK_MONOTONIC, &stopped);
+
+            /* Record how long it took. */
+            latency = nanos_between(pressed, stopped);
+            pthread_mutex_lock(&e->stats_lock);
+            e->num_stops++;
+            e->last_latency = latency;
+            if (latency > e->worst_latency)
+                e->worst_latency = latency;
+            pthread_mutex_unlock(&e->stats_lock);
+        }
+
+        /* Pass the key on to the frame loop, dropping it if the frame loop
+         * has fallen too far behind. Stop keys jump the queue. */
+        command_ring_push(&e->commands, key, is_stop);
+    }
+
+    return NULL;
+}
+
+/**
+ * This function initialises the estop provided to it and starts its input
+ * watcher. The watcher calls halt with arg as soon as a stop key is read,
+ * then queues every key in the command ring provided to it, with stop keys
+ * in the priority lane.
+ */
+void estop_init(estop* ep, command_ring* cp, void (*halt)(void*), void* arg)
+{
+    struct termios raw; /* The terminal's settings for the watcher. */
+    char* tstamp;       /* A time stamp. */
+
+    /* Allocate memory to the estop. */
+    *ep = (estop) malloc(sizeof(struct estop_data));
+
+    /* Initialise properties. */
+    (*ep)->halt = halt;
+    (*ep)->arg = arg;
+    atomic_init(&(*ep)->quit_armed, true);
+    atomic_init(&(*ep)->running, true);
+    (*ep)->commands = *cp;
+    (*ep)->num_stops = 0;
+    (*ep)->last_latency = 0;
+    (*ep)->worst_latency = 0;
+    pthread_mutex_init(&(*ep)->stats_lock, NULL);
+    atomic_store(&estop_halted, false);
+
+    /* Make keys readable as soon as they are pressed, without echoing
+     * them. */
+    if (tcgetattr(0, &(*ep)->saved) < 0)
+        perror("tcgetattr()");
+    raw = (*ep)->saved;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(0, TCSANOW, &raw) < 0)
+        perror("tcsetattr ICANON");
+
+    /* Start the input watcher. */
+    if (pthread_create(&(*ep)->thread, NULL, estop_watch, *ep) != 0)
+    {
+        fprintf(stderr,
+                "[ %s ] ERROR: In function estop_init(): "
+                "Could not start the input watcher\n",
+                (tstamp = timestamp()));
+        free(tstamp);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * This function terminates the estop provided to it.
+ */
+void estop_term(estop* ep)
+{
+    /* Stop the input watcher. */
+    atomic_store(&(*ep)->running, false);
+    pthread_join((*ep)->thread, NULL);
+
+    /* Restore the terminal's settings. */
+    if (tcsetattr(0, TCSADRAIN, &(*ep)->saved) < 0)
+        perror("tcsetattr ~ICANON");
+
+    /* De-allocate memory from the estop. */
+    pthread_mutex_destroy(&(*ep)->stats_lock);
+    free(*ep);
+}
+
+/**
+ * This function sets whether the quit key stops the motors.
+ */
+void estop_arm_quit(estop* ep, bool armed)
+{
+    atomic_store(&(*ep)->quit_armed, armed);
+}
+
+/**
+ * This function returns whether the rover has been halted since the halt
+ * was last taken. Long motions check it so they can stop early.
+ */
+bool estop_is_halted()
+{
+    return atomic_load_explicit(&estop_halted, memory_order_relaxed);
+}
+
+/**
+ * This function halts the rover, as though a stop key had been pressed,
+ * without calling the halt function.
+ */
+void estop_halt()
+{
+    atomic_store(&estop_halted, true);
+}
+
+/**
+ * This function returns whether the rover has been halted, and clears the
+ * halt so motions can start again.
+ */
+bool estop_take()
+{
+    return atomic_exchange(&estop_halted, false);
+}
+
+/**
+ * This function gets the latency, in nanoseconds, between reading a stop
+ * key and the halt function returning, for the last stop and the slowest
+ * stop. It returns the number of stops.
+ */
+unsigned estop_get_latency(estop e, uint64_t* last, uint64_t* worst)
+{
+    unsigned num_stops; /* The number of stops. */
+
+    pthread_mutex_lock(&e->stats_lock);
+    num_stops = e->num_stops;
+    *last = e->last_latency;
+    *worst = e->worst_latency;
+    pthread_mutex_unlock(&e->stats_lock);
+
+    return num_stops;
+}
@@ -0,0 +1,88 @@
+/*
+ * estop.h
+ *
+ * This file contains the public data-structure and public function prototype
+ * declarations for the estop type, which watches the user's input on its
+ * own thread so that stop keys take effect without waiting for a frame.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#ifndef estop_h
+#define estop_h
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "mycutils.h"
+#include "command_ring.h"
+
+/* This is the key that stops the rover's motors from any screen. */
+#define ESTOP_STOP_KEY 'x'
+
+/* This is the key that quits the current screen. It only stops the motors
+ * while quitting has been armed. */
+#define ESTOP_QUIT_KEY 'q'
+
+/* This is how long, in milliseconds, the input watcher waits for a key
+ * before checking whether it should finish. */
+#define ESTOP_POLL_MILLIS 50
+
+/**
+ * This is the data-structure of the estop type.
+ */
+typedef struct estop_data* estop;
+
+/**
+ * This function initialises the estop provided to it and starts its input
+ * watcher. The watcher calls halt with arg as soon as a stop key is read,
+ * then queues every key in the command ring provided to it, with stop keys
+ * in the priority lane.
+ */
+void estop_init(estop* ep, command_ring* cp, void (*halt)(void*), void* arg);
+
+/**
+ * This function terminates the estop provided to it.
+ */
+void estop_term(estop* ep);
+
+/**
+ * This function sets whether the quit key stops the motors.
+ */
+void estop_arm_quit(estop* ep, bool armed);
+
+/**
+ * This function returns whether the rover has been halted since the halt
+ * was last taken. Long motions check it so they can stop early.
+ */
+bool estop_is_halted();
+
+/**
+ * This function halts the rover, as though a stop key had been pressed,
+ * without calling the halt function.
+ */
+void estop_halt();
+
+/**
+ * This function returns whether the rover has been halted, and clears the
+ * halt so motions can start again.
+ */
+bool estop_take();
+
+/**
+ * This function gets the latency, in nanoseconds, between reading a stop
+ * key and the halt function returning, for the last stop and the slowest
+ * stop. It returns the number of stops.
+ */
+unsigned estop_get_latency(estop e, uint64_t* last, uint64_t* worst);
+
+#endif
@@ -0,0 +1,137 @@
+/**
+ * gpio.c
+ *
+ * This file contains the function definitions for the gpio hardware
+ * abstraction layer, and its pi-gpio backend.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#include "gpio.h"
+#include "gpio_sim.h"
+
+#ifdef ROVER_PI_GPIO
+
+/**
+ * This function sets up a pin through pi-gpio. It wraps setup_gpio() so the
+ * backend's functions all take ints.
+ */
+void pi_setup_gpio(int pin, int direction, int pud)
+{
+    setup_gpio(pin, direction, pud);
+}
+
+/**
+ * This is the backend that drives the real pins through pi-gpio.
+ */
+gpio_backend pi_backend = {
+    .name = "pi-gpio",
+    .setup = setup,
+    .cleanup = cleanup,
+    .setup_gpio = pi_setup_gpio,
+    .output_gpio = output_gpio,
+    .input_gpio = input_gpio,
+    .get_rpi_info = get_rpi_info,
+    .hardware_pwm = true
+};
+
+#endif
+
+/**
+ * This is the backend that is selected. Builds with pi-gpio start on the
+ * real pins, and builds without it start on the simulation.
+ */
+gpio_backend* selected_backend = NULL;
+
+/**
+ * This function returns the backend that drives the real pins through
+ * pi-gpio, or NULL if the program was built without pi-gpio.
+ */
+gpio_backend* gpio_pi_backend()
+{
+#ifdef ROVER_PI_GPIO
+    return &pi_backend;
+#else
+    return NULL;
+#endif
+}
+
+/**
+ * This function selects the backend provided to it. It must be called
+ * before gpio_setup().
+ */
+void gpio_select(gpio_backend* b)
+{
+    selected_backend = b;
+}
+
+/**
+ * This function returns the backend that is selected.
+ */
+gpio_backend* gpio_get_backend()
+{
+    /* Fall back to the default backend if none has been selected. */
+    if (selected_backend == NULL)
+        selected_backend = gpio_pi_backend() != NULL ? gpio_pi_backend()
+                                                     : gpio_sim_backend();
+    return selected_backend;
+}
+
+/**
+ * This function sets up the selected backend.
+ */
+void gpio_setup()
+{
+    gpio_get_backend()->setup();
+}
+
+/**
+ * This function cleans up the selected backend.
+ */
+void gpio_cleanup()
+{
+    gpio_get_backend()->cleanup();
+}
+
+/**
+ * This function sets up a pin as an input or an output. Inputs can be
+ * pulled up or down.
+ */
+void gpio_setup_pin(int pin, int direction, int pud)
+{
+    gpio_get_backend()->setup_gpio(pin, direction, pud);
+}
+
+/**
+ * This function sets an output pin HIGH or LOW.
+ */
+void gpio_output(int pin, int value)
+{
+    gpio_get_backend()->output_gpio(pin, value);
+}
+
+/**
+ * This function returns whether an input pin is HIGH or LOW.
+ */
+int gpio_input(int pin)
+{
+    return trace_input(pin, gpio_get_backend()->input_gpio(pin));
+}
+
+/**
+ * This function gets information about the raspberry pi.
+ */
+int gpio_get_info(rpi_info* info)
+{
+    return gpio_get_backend()->get_rpi_info(info);
+}
+
+/**
+ * This function returns whether the kernel's hardware pwm can be used to
+ * drive pins.
+ */
+bool gpio_has_hardware_pwm()
+{
+    return gpio_get_backend()->hardware_pwm;
+}
@@ -0,0 +1,120 @@
+/*
+ * gpio.h
+ *
+ * This file contains the public data-structure and public function prototype
+ * declarations for the gpio hardware abstraction layer. Every module reads
+ * and writes pins through it, and it passes them on to whichever backend
+ * was selected at startup: the real pins through pi-gpio, or a simulation.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#ifndef gpio_h
+#define gpio_h
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "trace.h"
+
+#ifdef ROVER_PI_GPIO
+#include <pi-gpio.h>
+#else
+
+/* These are the values pi-gpio uses, for builds without it. */
+#define INPUT 1
+#define OUTPUT 0
+#define HIGH 1
+#define LOW 0
+#define PUD_OFF 0
+#define PUD_DOWN 1
+#define PUD_UP 2
+
+/**
+ * This is the information pi-gpio gives about the raspberry pi, for builds
+ * without it.
+ */
+typedef struct {
+    int p1_revision;
+    char* ram;
+    char* manufacturer;
+    char* processor;
+    char* type;
+    char revision[1024];
+} rpi_info;
+
+#endif
+
+/**
+ * This is a gpio backend. Each function does what the pi-gpio function of
+ * the same name does.
+ */
+typedef struct {
+    char* name;                             /* The name of the backend. */
+    int (*setup)(void);
+    void (*cleanup)(void);
+    void (*setup_gpio)(int pin, int direction, int pud);
+    void (*output_gpio)(int pin, int value);
+    int (*input_gpio)(int pin);
+    int (*get_rpi_info)(rpi_info* info);
+    bool hardware_pwm;                      /* Whether the kernel's hardware
+                                             * pwm drives real pins. */
+} gpio_backend;
+
+/**
+ * This function returns the backend that drives the real pins through
+ * pi-gpio, or NULL if the program was built without pi-gpio.
+ */
+gpio_backend* gpio_pi_backend();
+
+/**
+ * This function selects the backend provided to it. It must be called
+ * before gpio_setup().
+ */
+void gpio_select(gpio_backend* backend);
+
+/**
+ * This function returns the backend that is selected.
+ */
+gpio_backend* gpio_get_backend();
+
+/**
+ * This function sets up the selected backend.
+ */
+void gpio_setup();
+
+/**
+ * This function cleans up the selected backend.
+ */
+void gpio_cleanup();
+
+/**
+ * This function sets up a pin as an input or an output. Inputs can be
+ * pulled up or down.
+ */
+void gpio_setup_pin(int pin, int direction, int pud);
+
+/**
+ * This function sets an output pin HIGH or LOW.
+ */
+void gpio_output(int pin, int value);
+
+/**
+ * This function returns whether an input pin is HIGH or LOW.
+ */
+int gpio_input(int pin);
+
+/**
+ * This function gets information about the raspberry pi.
+ */
+int gpio_get_info(rpi_info* info);
+
+/**
+ * This function returns whether the kernel's hardware pwm can be used to
+ * drive pins.
+ */
+bool gpio_has_hardware_pwm();
+
+#endif
@@ -0,0 +1,226 @@
+/**
+ * gpio_sim.c
+ *
+ * This file contains the internal data-structure and function definitions
+ * for the simulated gpio backend.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#include "gpio_sim.h"
+
+/**
+ * This is one of the simulation's pins.
+ */
+typedef struct {
+    int direction;      /* Whether the pin is an INPUT or an OUTPUT. */
+    int pud;            /* Whether the pin is pulled up or down. */
+    int output;         /* The level the pin was last set to. */
+    uint64_t writes;    /* The number of times the pin has been set. */
+    int input;          /* The scripted level of the pin, or -1. */
+    int link;           /* The output pin the pin follows, or -1. */
+} sim_pin;
+
+/**
+ * This is the state of the simulation.
+ */
+struct {
+    sim_pin pins[GPIO_SIM_NUM_PINS];    /* The pins. */
+    void (*on_output)(int, int, void*); /* Tells a model about outputs. */
+    int (*on_input)(int, void*);        /* Asks a model about inputs. */
+    void* arg;                          /* Passed to the model. */
+    pthread_mutex_t lock;               /* Guards all of the above. */
+} sim_state = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/**
+ * This function returns true if the pin provided to it exists.
+ */
+bool sim_pin_exists(int pin)
+{
+    return pin >= 0 && pin < GPIO_SIM_NUM_PINS;
+}
+
+/**
+ * This function resets every pin of the simulation.
+ */
+int sim_setup(void)
+{
+    int p;
+
+    pthread_mutex_lock(&sim_state.lock);
+    for (p = 0; p < GPIO_SIM_NUM_PINS; p++)
+        sim_state.pins[p] = (sim_pin) { INPUT, PUD_OFF, LOW, 0, -1, -1 };
+    pthread_mutex_unlock(&sim_state.lock);
+    return 0;
+}
+
+/**
+ * This function does nothing, as the simulation has nothing to clean up.
+ */
+void sim_cleanup(void)
+{
+}
+
+/**
+ * This function sets up a simulated pin.
+ */
+void sim_setup_gpio(int pin, int direction, int pud)
+{
+    if (!sim_pin_exists(pin))
+        return;
+    pthread_mutex_lock(&sim_state.lock);
+    sim_state.pins[pin].direction = direction;
+    sim_state.pins[pin].pud = pud;
+    pthread_mutex_unlock(&sim_state.lock);
+}
+
+/**
+ * This function sets a simulated output pin and tells the model about it.
+ */
+void sim_output_gpio(int pin, int value)
+{
+    if (!sim_pin_exists(pin))
+        return;
+    pthread_mutex_lock(&sim_state.lock);
+    sim_state.pins[pin].output = value;
+    sim_state.pins[pin].writes++;
+    if (sim_state.on_output != NULL)
+        sim_state.on_output(pin, value, sim_state.arg);
+    pthread_mutex_unlock(&sim_state.lock);
+}
+
+/**
+ * This function reads a simulated input pin. The model is asked first,
+ * then the pin's link, then its script, and otherwise it reads whichever
+ * way it is pulled.
+ */
+int sim_input_gpio(int pin)
+{
+    sim_pin* p;     /* The pin. */
+    int level;      /* The level of the pin. */
+
+    if (!sim_pin_exists(pin))
+        return LOW;
+    pthread_mutex_lock(&sim_state.lock);
+    p = &sim_state.pins[pin];
+    level = -1;
+    if (sim_state.on_input != NULL)
+        level = sim_state.on_input(pin, sim_state.arg);
+    if (level < 0 && p->link >= 0)
+        level = sim_state.pins[p->link].output;
+    if (level < 0 && p->input >= 0)
+        level = p->input;
+    if (level < 0)
+        level = p->pud == PUD_UP ? HIGH : LOW;
+    pthread_mutex_unlock(&sim_state.lock);
+
+    return level;
+}
+
+/**
+ * This function describes the simulation as a raspberry pi.
+ */
+int sim_get_rpi_info(rpi_info* info)
+{
+    info->p1_revision = 3;
+    info->ram = "None";
+    info->manufacturer = "Simulation";
+    info->processor = "None";
+    info->type = "Simulated";
+    strcpy(info->revision, "0");
+    return 0;
+}
+
+/**
+ * This is the simulated backend.
+ */
+gpio_backend sim_backend = {
+    .name = "simulation",
+    .setup = sim_setup,
+    .cleanup = sim_cleanup,
+    .setup_gpio = sim_setup_gpio,
+    .output_gpio = sim_output_gpio,
+    .input_gpio = sim_input_gpio,
+    .get_rpi_info = sim_get_rpi_info,
+    .hardware_pwm = false
+};
+
+/**
+ * This function returns the simulated gpio backend.
+ */
+gpio_backend* gpio_sim_backend()
+{
+    return &sim_backend;
+}
+
+/**
+ * This function makes an input pin read the level provided to it.
+ */
+void gpio_sim_set_input(int pin, int level)
+{
+    if (!sim_pin_exists(pin))
+        return;
+    pthread_mutex_lock(&sim_state.lock);
+    sim_state.pins[pin].input = level;
+    pthread_mutex_unlock(&sim_state.lock);
+}
+
+/**
+ * This function makes an input pin read whatever an output pin was last
+ * set to, like a device that answers as soon as it is asked.
+ */
+void gpio_sim_link(int input_pin, int output_pin)
+{
+    if (!sim_pin_exists(input_pin) || !sim_pin_exists(output_pin))
+        return;
+    pthread_mutex_lock(&sim_state.lock);
+    sim_state.pins[input_pin].link = output_pin;
+    pthread_mutex_unlock(&sim_state.lock);
+}
+
+/**
+ * This function sets the functions a model of the rover's hardware is
+ * told about outputs with, and asked about inputs with. The input function
+ * returns the level of the pin, or -1 to leave it to the script. Either
+ * function can be NULL.
+ */
+void gpio_sim_set_model(void (*on_output)(int pin, int value, void* arg),
+                        int (*on_input)(int pin, void* arg), void* arg)
+{
+    pthread_mutex_lock(&sim_state.lock);
+    sim_state.on_output = on_output;
+    sim_state.on_input = on_input;
+    sim_state.arg = arg;
+    pthread_mutex_unlock(&sim_state.lock);
+}
+
+/**
+ * This function returns the level an output pin was last set to.
+ */
+int gpio_sim_get_output(int pin)
+{
+    int level;  /* The level of the pin. */
+
+    if (!sim_pin_exists(pin))
+        return LOW;
+    pthread_mutex_lock(&sim_state.lock);
+    level = sim_state.pins[pin].output;
+    pthread_mutex_unlock(&sim_state.lock);
+    return level;
+}
+
+/**
+ * This function returns the number of times an output pin has been set.
+ */
+uint64_t gpio_sim_get_writes(int pin)
+{
+    uint64_t writes;    /* The number of writes. */
+
+    if (!sim_pin_exists(pin))
+        return 0;
+    pthread_mutex_lock(&sim_state.lock);
+    writes = sim_state.pins[pin].writes;
+    pthread_mutex_unlock(&sim_state.lock);
+    return writes;
+}
@@ -0,0 +1,62 @@
+/*
+ * gpio_sim.h
+ *
+ * This file contains the public function prototype declarations for the
+ * simulated gpio backend. It records what is written to every output pin
+ * and feeds scripted levels to the input pins, so the rover can run
+ * without a raspberry pi.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#ifndef gpio_sim_h
+#define gpio_sim_h
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "gpio.h"
+
+/* This is the number of pins the simulation has. */
+#define GPIO_SIM_NUM_PINS 64
+
+/**
+ * This function returns the simulated gpio backend.
+ */
+gpio_backend* gpio_sim_backend();
+
+/**
+ * This function makes an input pin read the level provided to it.
+ */
+void gpio_sim_set_input(int pin, int level);
+
+/**
+ * This function makes an input pin read whatever an output pin was last
+ * set to, like a device that answers as soon as it is asked.
+ */
+void gpio_sim_link(int input_pin, int output_pin);
+
+/**
+ * This function sets the functions a model of the rover's hardware is
+ * told about outputs with, and asked about inputs with. The input function
+ * returns the level of the pin, or -1 to leave it to the script. Either
+ * function can be NULL.
+ */
+void gpio_sim_set_model(void (*on_output)(int pin, int value, void* arg),
+                        int (*on_input)(int pin, void* arg), void* arg);
+
+/**
+ * This function returns the level an output pin was last set to.
+ */
+int gpio_sim_get_output(int pin);
+
+/**
+ * This function returns the number of times an output pin has been set.
+ */
+uint64_t gpio_sim_get_writes(int pin);
+
+#endif
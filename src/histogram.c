@@ -0,0 +1,180 @@
+/**
+ * histogram.c
+ *
+ * This file contains the internal data-structure and function definitions
+ * for the histogram type.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#include "histogram.h"
+
+/* This is the number of buckets in each power of two, past the first. */
+#define HISTOGRAM_HALF (1 << (HISTOGRAM_SUB_BITS - 1))
+
+/**
+ * This is the internal data of the histogram type.
+ *
+ * Values below 2 * HISTOGRAM_HALF each have a bucket of their own. Above
+ * that, every power of two is split into HISTOGRAM_HALF buckets of the
+ * same width, so each bucket is as wide as a fixed fraction of the values
+ * in it.
+ */
+struct histogram_data {
+    uint64_t counts[HISTOGRAM_NUM_BUCKETS]; /* The values in each bucket. */
+    uint64_t count;                         /* The values counted. */
+    uint64_t max;                           /* The largest value. */
+};
+
+/**
+ * This function returns the bucket the value provided to it belongs in.
+ */
+int histogram_bucket(uint64_t value)
+{
+    int shift;  /* The bits of the value the bucket drops. */
+
+    /* Small values have their own buckets. */
+    if (value < 2 * HISTOGRAM_HALF)
+        return (int) value;
+
+    /* Keep the value's top HISTOGRAM_SUB_BITS bits. */
+    shift = 63 - __builtin_clzll(value) - (HISTOGRAM_SUB_BITS - 1);
+    return shift * HISTOGRAM_HALF + (int) (value >> shift);
+}
+
+/**
+ * This function returns the largest value the bucket provided to it
+ * holds.
+ */
+uint64_t histogram_bucket_top(int bucket)
+{
+    int shift;  /* The bits of the values the bucket drops. */
+
+    /* Small values have their own buckets. */
+    if (bucket < 2 * HISTOGRAM_HALF)
+        return (uint64_t) bucket;
+
+    shift = bucket / HISTOGRAM_HALF - 1;
+    return (((uint64_t) (bucket - shift * HISTOGRAM_HALF) + 1) << shift) - 1;
+}
+
+/**
+ * This function initialises the histogram provided to it, empty.
+ */
+void histogram_init(histogram* hp)
+{
+    /* Allocate memory to the histogram. */
+    *hp = (histogram) malloc(sizeof(struct histogram_data));
+
+    /* Empty it. */
+    histogram_reset(hp);
+}
+
+/**
+ * This function terminates the histogram provided to it.
+ */
+void histogram_term(histogram* hp)
+{
+    /* De-allocate memory from the histogram. */
+    free(*hp);
+}
+
+/**
+ * This function empties the histogram provided to it.
+ */
+void histogram_reset(histogram* hp)
+{
+    int b;
+
+    for (b = 0; b < HISTOGRAM_NUM_BUCKETS; b++)
+        (*hp)->counts[b] = 0;
+    (*hp)->count = 0;
+    (*hp)->max = 0;
+}
+
+/**
+ * This function counts the value provided to it in the histogram provided
+ * to it.
+ */
+void histogram_record(histogram* hp, uint64_t value)
+{
+    (*hp)->counts[histogram_bucket(value)]++;
+    (*hp)->count++;
+    if (value > (*hp)->max)
+        (*hp)->max = value;
+}
+
+/**
+ * This function returns the number of values counted in the histogram
+ * provided to it.
+ */
+uint64_t histogram_get_count(histogram h)
+{
+    return h->count;
+}
+
+/**
+ * This function returns the largest value counted in the histogram
+ * provided to it, exactly.
+ */
+uint64_t histogram_get_max(histogram h)
+{
+    return h->max;
+}
+
+/**
+ * This function returns the value that the percentage provided to it of
+ * the values counted in the histogram provided to it are at or below.
+ */
+uint64_t histogram_percentile(histogram h, double percent)
+{
+    uint64_t wanted;    /* The number of values to get past. */
+    uint64_t seen = 0;  /* The number of values got past. */
+    uint64_t top;       /* The largest value of a bucket. */
+    int b;
+
+    if (h->count == 0)
+        return 0;
+
+    /* Work out how many values have to be at or below it, which is always
+     * at least one. */
+    wanted = (uint64_t) (percent / 100 * h->count + 0.5);
+    if (wanted < 1)
+        wanted = 1;
+
+    /* Find the bucket that gets past them. No bucket holds anything larger
+     * than the largest value. */
+    for (b = 0; b < HISTOGRAM_NUM_BUCKETS; b++)
+    {
+        seen += h->counts[b];
+        if (seen >= wanted)
+        {
+            top = histogram_bucket_top(b);
+            return top < h->max ? top : h->max;
+        }
+    }
+
+    return h->max;
+}
+
+/**
+ * This function prints every bucket of the histogram provided to it that
+ * has values in it on the file stream provided to it.
+ */
+void histogram_print(histogram h, char* label, FILE* fs)
+{
+    uint64_t seen = 0;  /* The values at or below the bucket. */
+    int b;
+
+    for (b = 0; b < HISTOGRAM_NUM_BUCKETS; b++)
+    {
+        if (h->counts[b] == 0)
+            continue;
+        seen += h->counts[b];
+        fprintf(fs, "%s\t%llu\t%llu\t%.3f\n", label,
+                (unsigned long long) histogram_bucket_top(b),
+                (unsigned long long) h->counts[b],
+                100.0 * seen / h->count);
+    }
+}
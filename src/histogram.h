@@ -0,0 +1,86 @@
+/**
+ * histogram.h
+ *
+ * This file contains the public data-structure and function prototype
+ * declarations for the histogram type.
+ *
+ * The histogram type counts values, such as how many nano-seconds
+ * something took, in buckets that are as wide as a small fraction of the
+ * values they hold. It can hold any 64 bit value to within about 3% in a
+ * fixed amount of memory, so recording a value never allocates anything
+ * and takes the same time however many values have been recorded.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#ifndef histogram_h
+#define histogram_h
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+/* This is the number of bits of every value the buckets keep. Values are
+ * kept to within one part in 2 to the power of one less than this. */
+#define HISTOGRAM_SUB_BITS 6
+
+/* This is the number of buckets a histogram has, which is enough for any
+ * 64 bit value. */
+#define HISTOGRAM_NUM_BUCKETS \
+    ((64 - HISTOGRAM_SUB_BITS + 2) << (HISTOGRAM_SUB_BITS - 1))
+
+/**
+ * This is the data-structure of the histogram type.
+ */
+typedef struct histogram_data* histogram;
+
+/**
+ * This function initialises the histogram provided to it, empty.
+ */
+void histogram_init(histogram* hp);
+
+/**
+ * This function terminates the histogram provided to it.
+ */
+void histogram_term(histogram* hp);
+
+/**
+ * This function empties the histogram provided to it.
+ */
+void histogram_reset(histogram* hp);
+
+/**
+ * This function counts the value provided to it in the histogram provided
+ * to it. Only one thread may record into a histogram at a time.
+ */
+void histogram_record(histogram* hp, uint64_t value);
+
+/**
+ * This function returns the number of values counted in the histogram
+ * provided to it.
+ */
+uint64_t histogram_get_count(histogram h);
+
+/**
+ * This function returns the largest value counted in the histogram
+ * provided to it, exactly.
+ */
+uint64_t histogram_get_max(histogram h);
+
+/**
+ * This function returns the value that the percentage provided to it of
+ * the values counted in the histogram provided to it are at or below. It
+ * returns 0 if the histogram is empty.
+ */
+uint64_t histogram_percentile(histogram h, double percent);
+
+/**
+ * This function prints every bucket of the histogram provided to it that
+ * has values in it on the file stream provided to it, one per line, as the
+ * label provided to it, the largest value the bucket holds, the values in
+ * it, and the percentage of values at or below it.
+ */
+void histogram_print(histogram h, char* label, FILE* fs);
+
+#endif
@@ -18,6 +18,7 @@ struct interface_data {
     bool start_screen_on;   /* Whether the start screen is on. */
     bool drive_screen_on;   /* Whether the drive screen is on. */
     bool rack_screen_on;    /* Whether the rack screen is on. */
+    bool stats_screen_on;   /* Whether the stats screen is on. */
     int min_width;          /* The minimum width of the interface. */
     int min_height;         /* The minimum height of the interface. */
 };
@@ -58,6 +59,7 @@ void interface_init(interface* ip)
     (*ip)->start_screen_on = true;
     (*ip)->drive_screen_on = false;
     (*ip)->rack_screen_on = false;
+    (*ip)->stats_screen_on = false;
 
     /* Set the minimum width and height of the interface. */
     (*ip)->min_width = 100;
@@ -80,11 +82,26 @@ void interface_term(interface* ip)
 }
 
 /**
- * This function gets input from the user and returns it.
+ * This function takes the next command the user queued in the command ring
+ * provided to it, stores it in recp and returns its key. It returns 0 if
+ * the user hasn't queued anything.
  */
-char interface_get_user_in()
+char interface_get_user_in(command_ring* cp, command_record* recp)
 {
-    return scanc_nowait();
+    /* Don't wait for the user, so the rover keeps running in between
+     * key presses. */
+    if (!command_ring_pop(cp, recp))
+        recp->key = 0;
+    return recp->key;
+}
+
+/**
+ * This function returns whether the rack screen of the interface provided
+ * to it is on.
+ */
+bool interface_is_rack_screen_on(interface i)
+{
+    return i->rack_screen_on;
 }
 
 /**
@@ -109,6 +126,11 @@ void build_start_commands(commands* cmdsp, char user_in)
         case 'r'  :
            (*cmdsp).interface_command = RACK_SCREEN_ON;
             break;
+
+        /* Show the stats screen. */
+        case 'p'  :
+            (*cmdsp).interface_command = STATS_SCREEN_ON;
+            break;
     }
 }
 
@@ -140,7 +162,12 @@ void build_drive_commands(commands* cmdsp, char user_in)
             (*cmdsp).drive_command = TURN_RIGHT;
             break;
 
-        /* Stop the rover. */
+        /* Brake the rover to a stop. */
+        case 'b' :
+            (*cmdsp).drive_command = BRAKE;
+            break;
+
+        /* Stop the rover immediately. */
         case 'x' :
             (*cmdsp).drive_command = STOP_DRIVE;
             break;
@@ -181,9 +208,20 @@ void build_rack_commands(commands* cmdsp, char user_in)
             (*cmdsp).rack_command = Z_CLOCKWISE;
             break;
 
+        /* Search for the brightest light. */
         case 'l' :
             (*cmdsp).rack_command = LIGHT_SEARCH;
             break;
+
+        /* Cancel the light search. */
+        case 'c' :
+            (*cmdsp).rack_command = CANCEL_LIGHT_SEARCH;
+            break;
+
+        /* Turn tracking of the light on or off. */
+        case 't' :
+            (*cmdsp).rack_command = TOGGLE_TRACKING;
+            break;
         
         /* Turn on the start screen. */
         case 'q' :
@@ -192,6 +230,21 @@ void build_rack_commands(commands* cmdsp, char user_in)
     }
 }
 
+/**
+ * This function builds a set of commands associated with the stats screen.
+ */
+void build_stats_commands(commands* cmdsp, char user_in)
+{
+    /* Checking what the user input. */
+    switch (user_in)
+    {
+        /* Turn on the start screen. */
+        case 'q' :
+            (*cmdsp).interface_command = START_SCREEN_ON;
+            break;
+    }
+}
+
 /**
  * This function builds a set of commands based on user input and the
  * current screen that is on.
@@ -224,6 +277,12 @@ void interface_build_commands(interface* ip, commands* cmdsp, char user_in)
     {
         build_rack_commands(cmdsp, user_in);
     }
+
+    /* Checking if the stats screen is on. */
+    else if ((*ip)->stats_screen_on)
+    {
+        build_stats_commands(cmdsp, user_in);
+    }
 }
 
 /**
@@ -243,21 +302,31 @@ void interface_update(interface* ip, enum InterfaceCommand interface_command)
             (*ip)->start_screen_on = false;
             (*ip)->drive_screen_on = false;
             (*ip)->rack_screen_on = false;
+            (*ip)->stats_screen_on = false;
             break;
         case START_SCREEN_ON :
             (*ip)->start_screen_on = true;
             (*ip)->drive_screen_on = false;
             (*ip)->rack_screen_on = false;
+            (*ip)->stats_screen_on = false;
             break;
         case DRIVE_SCREEN_ON :
             (*ip)->start_screen_on = false;
             (*ip)->drive_screen_on = true;
             (*ip)->rack_screen_on = false;
+            (*ip)->stats_screen_on = false;
             break;
         case RACK_SCREEN_ON :
             (*ip)->start_screen_on = false;
             (*ip)->drive_screen_on = false;
             (*ip)->rack_screen_on = true;
+            (*ip)->stats_screen_on = false;
+            break;
+        case STATS_SCREEN_ON :
+            (*ip)->start_screen_on = false;
+            (*ip)->drive_screen_on = false;
+            (*ip)->rack_screen_on = false;
+            (*ip)->stats_screen_on = true;
             break;
         case NO_INTERFACE_COMMAND:
             NULL;
@@ -323,11 +392,11 @@ void display_start_screen(interface i)
     info_pos.y = TITLE_HEIGHT + 1;
 
     /* Print information about the raspberry pi this program is running on. */
-    get_rpi_info(&info);
+    gpio_get_info(&info);
     print_rpi_info(info, info_pos);
 
     /* Create the control instructions. */
-    strfmt(&controls, "'d': Drive | 'r': Rack | 'q': Quit");
+    strfmt(&controls, "'d': Drive | 'r': Rack | 'p': Stats | 'q': Quit");
 
     /* Set the location of the control instructions. */
     controls_pos.x = i->term_res.x / 2 - strlen(controls) / 2;
@@ -397,6 +466,28 @@ void display_drive_bar(char* label, int duty_cycle, vec2d pos )
     free(bar);
 }
 
+/**
+ * This function displays where the drive thinks it is.
+ */
+void display_drive_pose(interface i, drive d)
+{
+    vec2d pos;          /* The position of the pose message. */
+    odometry_pose pose; /* Where the drive thinks it is. */
+    char* msg;          /* The pose message. */
+
+    /* Create the pose message. */
+    pose = drive_get_pose(d);
+    strfmt(&msg, "Position: %.0f, %.0f mm | Heading: %.0f deg",
+           pose.x, pose.y, pose.heading * 180 / M_PI);
+
+    /* Set the position of the message, below the drive bars, and display
+     * it. */
+    pos.x = i->term_res.x / 2 - strlen(msg) / 2;
+    pos.y = i->term_res.y / 3 + 7;
+    print_str_mod(msg, pos, WHITE, NORMAL);
+    free(msg);
+}
+
 /**
  * This function displays the drive screen.
  */
@@ -417,22 +508,131 @@ void display_drive_screen(interface i, drive d)
     /* Display the drive bars. */ 
     display_drive_bar("Motor 1", drive_get_lmotor_duty_cycle(d), lmotor_pos);
     display_drive_bar("Motor 2", drive_get_rmotor_duty_cycle(d), rmotor_pos);
+
+    /* Display where the drive thinks it is. */
+    display_drive_pose(i, d);
     
-    display_controls(i, "'w': Accelerate | 'a': Left | 's': Decelerate | "
-                        "'d': Right | 'x': Stop | 'q': Start Screen");
+    display_controls(i, "'w': Faster | 'a': Left | 's': Slower | "
+                        "'d': Right | 'b': Brake | 'x': Stop | "
+                        "'q': Start Screen");
 
     /* Place the cursor in the top, right hand corner. */
     put_cursor(term_res.x, 0);
 }
 
+/**
+ * This function displays the progress of the rack's light search.
+ */
+void display_search_progress(interface i, rack r)
+{
+    vec2d pos;          /* The position of the progress message. */
+    char* progress;     /* The progress message. */
+    int position;       /* The position being visited. */
+    int num_positions;  /* The number of positions. */
+
+    /* Create the progress message. */
+    switch (rack_get_search_stage(r, &position, &num_positions))
+    {
+        case SEARCH_HOMING :
+            strfmt(&progress, "Light search: homing the z axis");
+            break;
+        case SEARCH_MOVING :
+            strfmt(&progress, "Light search: moving to %d of %d",
+                   position, num_positions);
+            break;
+        case SEARCH_READING :
+            strfmt(&progress, "Light search: reading %d of %d",
+                   position, num_positions);
+            break;
+        case SEARCH_RETURNING :
+            strfmt(&progress, "Light search: moving to the brightest position");
+            break;
+        case SEARCH_IDLE :
+        default :
+            strfmt(&progress, "Light search: idle");
+            break;
+    }
+
+    /* Set the position of the message and display it. */
+    pos.x = i->term_res.x / 2 - strlen(progress) / 2;
+    pos.y = i->term_res.y / 2;
+    print_str_mod(progress, pos, WHITE, NORMAL);
+    free(progress);
+
+    /* Display whether the light is being tracked below it. */
+    strfmt(&progress, "Tracking: %s", rack_is_tracking(r) ? "on" : "off");
+    pos.x = i->term_res.x / 2 - strlen(progress) / 2;
+    pos.y++;
+    print_str_mod(progress, pos, WHITE, NORMAL);
+
+    /* De-allocate memory. */
+    free(progress);
+}
+
 /**
  * This function displays the rack screen.
  */
-void display_rack_screen(interface i)
+void display_rack_screen(interface i, rack r)
 {
     /* Display the title of the screen. */
     display_screen_title_str(i, "Rack Screen");
 
+    /* Display the progress of the light search. */
+    display_search_progress(i, r);
+
+    display_controls(i, "'w'/'s': X axis | 'a'/'d': Z axis | "
+                        "'l': Search | 'c': Cancel | 't': Tracking | "
+                        "'q': Start Screen");
+
+    /* Place the cursor in the top, right hand corner. */
+    put_cursor(i->term_res.x, 0);
+}
+
+/**
+ * This function displays how long each phase of the rover's frames has
+ * taken.
+ */
+void display_phase_stats(interface i, phase_stats s)
+{
+    vec2d pos;          /* The position of a line of the table. */
+    phase_summary sum;  /* The summary of a phase. */
+    char* line;         /* A line of the table. */
+    int p;
+
+    /* Display the heading of the table. */
+    strfmt(&line, "%-26s %8s %10s %10s %10s",
+           "Phase", "Count", "p50 ms", "p99 ms", "Max ms");
+    pos.x = i->term_res.x / 2 - strlen(line) / 2;
+    pos.y = i->term_res.y / 3;
+    print_str_mod(line, pos, WHITE, BOLD);
+    free(line);
+
+    /* Display a line for each phase. */
+    for (p = 0; p < NUM_PHASES; p++)
+    {
+        sum = phase_stats_summarise(s, p);
+        strfmt(&line, "%-26s %8llu %10.3f %10.3f %10.3f",
+               phase_stats_name(p), (unsigned long long) sum.count,
+               sum.p50 / 1e6, sum.p99 / 1e6, sum.max / 1e6);
+        pos.y++;
+        print_str_mod(line, pos, WHITE, NORMAL);
+        free(line);
+    }
+}
+
+/**
+ * This function displays the stats screen.
+ */
+void display_stats_screen(interface i, phase_stats s)
+{
+    /* Display the title of the screen. */
+    display_screen_title_str(i, "Stats Screen");
+
+    /* Display how long the phases have taken. */
+    display_phase_stats(i, s);
+
+    display_controls(i, "'q': Start Screen");
+
     /* Place the cursor in the top, right hand corner. */
     put_cursor(i->term_res.x, 0);
 }
@@ -440,7 +640,7 @@ void display_rack_screen(interface i)
 /**
  * This function displays the interface.
  */
-void interface_display(interface i, drive d, rack r)
+void interface_display(interface i, drive d, rack r, phase_stats s)
 {
     /* Clear the terminal. */
     clear();
@@ -448,6 +648,7 @@ void interface_display(interface i, drive d, rack r)
     /* Check which screen to display and display it. */
     if (i->start_screen_on) display_start_screen(i);
     else if (i->drive_screen_on) display_drive_screen(i, d);
-    else if (i->rack_screen_on) display_rack_screen(i);
+    else if (i->rack_screen_on) display_rack_screen(i, r);
+    else if (i->stats_screen_on) display_stats_screen(i, s);
 }
 
@@ -18,8 +18,10 @@
 
 #include "drive.h"
 #include "rack.h"
+#include "estop.h"
 #include "mycutils.h"
 #include "rpiutils.h"
+#include "phase_stats.h"
 
 /**
  * These are the commands that can be sent to the interface.
@@ -29,7 +31,8 @@ enum InterfaceCommand {
     TERMINATE,
     START_SCREEN_ON,
     DRIVE_SCREEN_ON,
-    RACK_SCREEN_ON
+    RACK_SCREEN_ON,
+    STATS_SCREEN_ON
 };
 
 /**
@@ -57,9 +60,17 @@ void interface_init(interface* ip);
 void interface_term(interface* ip);
 
 /**
- * This function gets input from the user and returns it.
+ * This function takes the next command the user queued in the command ring
+ * provided to it, stores it in recp and returns its key. It returns 0 if
+ * the user hasn't queued anything.
  */
-char interface_get_user_in();
+char interface_get_user_in(command_ring* cp, command_record* recp);
+
+/**
+ * This function returns whether the rack screen of the interface provided
+ * to it is on.
+ */
+bool interface_is_rack_screen_on(interface i);
 
 /**
  * This function builds a set of commands based on user input and the
@@ -73,8 +84,9 @@ void interface_build_commands(interface* ip, commands* cmdsp, char user_in);
 void interface_update(interface* ip, enum InterfaceCommand interface_command);
 
 /**
- * This function displays the interface.
+ * This function displays the interface. The stats screen shows how long
+ * the phases in the phase_stats provided to it have taken.
  */
-void interface_display(interface i, drive d, rack r);
+void interface_display(interface i, drive d, rack r, phase_stats s);
 
 #endif
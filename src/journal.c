@@ -0,0 +1,279 @@
+/**
+ * journal.c
+ *
+ * This file contains the internal data-structure and function definitions
+ * for the journal type.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#include "journal.h"
+
+/**
+ * This value marks a slot of the journal as holding a record.
+ */
+#define JOURNAL_MAGIC 0x52564a31
+
+/**
+ * This is a record that is stored in one of the journal's slots.
+ */
+typedef struct {
+    uint32_t magic;     /* Marks the slot as holding a record. */
+    uint32_t sequence;  /* Increases every time a record is committed. */
+    int32_t cur_x;      /* The current angle of the x axis. */
+    int32_t cur_z;      /* The current angle of the z axis. */
+    int64_t x_steps;    /* The current step position of the x axis. */
+    int64_t z_steps;    /* The current step position of the z axis. */
+    uint32_t checksum;  /* The checksum of everything above. */
+} journal_record;
+
+/**
+ * This is the internal data-structure of the journal type.
+ */
+struct journal_data {
+
+    /* This is the memory the journal's file is mapped to. */
+    unsigned char* map;
+
+    /* This is the size of one slot. Each slot is a whole page so that
+     * committing one never touches the other. */
+    size_t slot_size;
+
+    /* This is the slot holding the newest valid record, or -1. */
+    int newest;
+
+    /* This is the state waiting to be written. */
+    journal_state staged;
+
+    /* This is whether there is a state waiting to be written. */
+    bool dirty;
+
+    /* This is the minimum amount of time between writes. */
+    uint64_t write_interval;
+
+    /* This is the time of the last write. */
+    struct timespec last_write;
+};
+
+/**
+ * This function prints an error message about the journal function named
+ * fname and exits the program.
+ */
+void journal_error(char* fname)
+{
+    char* tstamp;   /* A time stamp. */
+
+    /* Print an error message. */
+    fprintf(stderr,
+            "[ %s ] ERROR: In function %s(): %s\n",
+            (tstamp = timestamp()), fname, strerror(errno));
+
+    /* De-allocate memory. */
+    free(tstamp);
+
+    /* Exit the program. */
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * This function returns the checksum of the record provided to it.
+ */
+uint32_t journal_checksum(journal_record* record)
+{
+    const unsigned char* bytes = (const unsigned char*) record;
+    uint32_t hash = 2166136261u;    /* FNV-1a offset basis. */
+    size_t b;
+
+    /* Hash every byte before the checksum. */
+    for (b = 0; b < offsetof(journal_record, checksum); b++)
+    {
+        hash ^= bytes[b];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * This function returns the record in the slot provided to it.
+ */
+journal_record* journal_slot(journal j, int slot)
+{
+    return (journal_record*) (j->map + slot * j->slot_size);
+}
+
+/**
+ * This function returns true if the record provided to it is valid.
+ */
+bool journal_is_valid(journal_record* record)
+{
+    return record->magic == JOURNAL_MAGIC
+        && record->checksum == journal_checksum(record);
+}
+
+/**
+ * This function initialises the journal provided to it, mapping the file
+ * at the path provided to it. Staged states are written to the file at
+ * most once every write_interval nano-seconds.
+ */
+void journal_init(journal* jp, char* fname, uint64_t write_interval)
+{
+    int fd;                 /* The file descriptor of the journal. */
+    journal_record* a;      /* The record in the first slot. */
+    journal_record* b;      /* The record in the second slot. */
+
+    /* Allocate memory to the journal. */
+    *jp = (journal) malloc(sizeof(struct journal_data));
+
+    /* Initialise properties. */
+    (*jp)->slot_size = sysconf(_SC_PAGESIZE);
+    (*jp)->dirty = false;
+    (*jp)->write_interval = write_interval;
+    start_timer(&(*jp)->last_write);
+
+    /* Open the file and make sure it is big enough for both slots. New
+     * space in the file reads as zeros, which is never a valid record. */
+    if ((fd = open(fname, O_RDWR | O_CREAT, 0644)) == -1)
+        journal_error("journal_init");
+    if (ftruncate(fd, 2 * (*jp)->slot_size) == -1)
+        journal_error("journal_init");
+
+    /* Map the file into memory. */
+    (*jp)->map = mmap(NULL, 2 * (*jp)->slot_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+    if ((*jp)->map == MAP_FAILED)
+        journal_error("journal_init");
+    close(fd);
+
+    /* Find the newest valid record. */
+    a = journal_slot(*jp, 0);
+    b = journal_slot(*jp, 1);
+    if (journal_is_valid(a) && journal_is_valid(b))
+        (*jp)->newest = (int32_t) (b->sequence - a->sequence) > 0 ? 1 : 0;
+    else if (journal_is_valid(a))
+        (*jp)->newest = 0;
+    else if (journal_is_valid(b))
+        (*jp)->newest = 1;
+    else
+        (*jp)->newest = -1;
+
+    /* Start with the newest state staged so it isn't written again. */
+    (*jp)->staged = (journal_state) { 0, 0, 0, 0 };
+    journal_recover(*jp, &(*jp)->staged);
+}
+
+/**
+ * This function writes any staged state and terminates the journal
+ * provided to it.
+ */
+void journal_term(journal* jp)
+{
+    /* Write any staged state. */
+    journal_flush(jp);
+
+    /* Unmap the file and de-allocate memory from the journal. */
+    munmap((*jp)->map, 2 * (*jp)->slot_size);
+    free(*jp);
+}
+
+/**
+ * This function sets the minimum amount of time between writes of the
+ * journal provided to it.
+ */
+void journal_set_write_interval(journal* jp, uint64_t write_interval)
+{
+    (*jp)->write_interval = write_interval;
+}
+
+/**
+ * This function stores the last valid state committed to the journal in
+ * the state provided to it. It returns false if the journal holds no
+ * valid state.
+ */
+bool journal_recover(journal j, journal_state* state)
+{
+    journal_record* record; /* The newest valid record. */
+
+    /* Check if there is a valid record. */
+    if (j->newest == -1)
+        return false;
+
+    /* Copy the record into the state. */
+    record = journal_slot(j, j->newest);
+    state->cur_x = record->cur_x;
+    state->cur_z = record->cur_z;
+    state->x_steps = record->x_steps;
+    state->z_steps = record->z_steps;
+
+    return true;
+}
+
+/**
+ * This function stages a state to be written to the journal.
+ */
+void journal_update(journal* jp, journal_state state)
+{
+    /* Only stage states that differ from the last one. */
+    if (state.cur_x != (*jp)->staged.cur_x
+        || state.cur_z != (*jp)->staged.cur_z
+        || state.x_steps != (*jp)->staged.x_steps
+        || state.z_steps != (*jp)->staged.z_steps)
+    {
+        (*jp)->staged = state;
+        (*jp)->dirty = true;
+    }
+}
+
+/**
+ * This function writes the staged state to the journal if the write
+ * interval has elapsed since the last write.
+ */
+void journal_sync(journal* jp)
+{
+    if ((*jp)->dirty && check_timer((*jp)->last_write, (*jp)->write_interval))
+        journal_flush(jp);
+}
+
+/**
+ * This function writes the staged state to the journal immediately.
+ */
+void journal_flush(journal* jp)
+{
+    journal_record* record; /* The record being committed. */
+    uint32_t sequence;      /* The sequence number of the new record. */
+    int slot;               /* The slot the record is committed to. */
+
+    /* Check if there is anything to write. */
+    if (!(*jp)->dirty)
+        return;
+
+    /* Commit over the older of the two slots. */
+    if ((*jp)->newest == -1)
+    {
+        slot = 0;
+        sequence = 1;
+    }
+    else
+    {
+        slot = 1 - (*jp)->newest;
+        sequence = journal_slot(*jp, (*jp)->newest)->sequence + 1;
+    }
+
+    /* Fill in the record and seal it with its checksum. */
+    record = journal_slot(*jp, slot);
+    record->magic = JOURNAL_MAGIC;
+    record->sequence = sequence;
+    record->cur_x = (*jp)->staged.cur_x;
+    record->cur_z = (*jp)->staged.cur_z;
+    record->x_steps = (*jp)->staged.x_steps;
+    record->z_steps = (*jp)->staged.z_steps;
+    record->checksum = journal_checksum(record);
+
+    /* Write the slot to disk before treating it as the newest. */
+    if (msync((unsigned char*) record, (*jp)->slot_size, MS_SYNC) == -1)
+        journal_error("journal_flush");
+    (*jp)->newest = slot;
+    (*jp)->dirty = false;
+    start_timer(&(*jp)->last_write);
+}
@@ -0,0 +1,90 @@
+/**
+ * journal.h
+ *
+ * This file contains the public data-structure and function prototype
+ * declarations for the journal type.
+ *
+ * The journal type keeps the position of the rack in a small memory-mapped
+ * file. The file holds two copies of the position and each new position is
+ * committed over the older copy, so a power cut while writing can only
+ * ever damage one of them.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#ifndef journal_h
+#define journal_h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mycutils.h"
+
+/**
+ * This is the state of the rack that is stored in the journal.
+ */
+typedef struct {
+    int cur_x;      /* The current angle of the x axis. */
+    int cur_z;      /* The current angle of the z axis. */
+    long x_steps;   /* The current step position of the x axis. */
+    long z_steps;   /* The current step position of the z axis. */
+} journal_state;
+
+/**
+ * This is the data-structure of the journal type.
+ */
+typedef struct journal_data* journal;
+
+/**
+ * This function initialises the journal provided to it, mapping the file
+ * at the path provided to it. Staged states are written to the file at
+ * most once every write_interval nano-seconds.
+ */
+void journal_init(journal* jp, char* fname, uint64_t write_interval);
+
+/**
+ * This function writes any staged state and terminates the journal
+ * provided to it.
+ */
+void journal_term(journal* jp);
+
+/**
+ * This function sets the minimum amount of time between writes of the
+ * journal provided to it.
+ */
+void journal_set_write_interval(journal* jp, uint64_t write_interval);
+
+/**
+ * This function stores the last valid state committed to the journal in
+ * the state provided to it. It returns false if the journal holds no
+ * valid state.
+ */
+bool journal_recover(journal j, journal_state* state);
+
+/**
+ * This function stages a state to be written to the journal.
+ */
+void journal_update(journal* jp, journal_state state);
+
+/**
+ * This function writes the staged state to the journal if the write
+ * interval has elapsed since the last write.
+ */
+void journal_sync(journal* jp);
+
+/**
+ * This function writes the staged state to the journal immediately.
+ */
+void journal_flush(journal* jp);
+
+#endif
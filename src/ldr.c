@@ -20,6 +20,8 @@ struct ldr_data {
     int send_pin;
     int read_pin1;
     int read_pin2;
+    bool pending;           /* Whether a reading has been requested. */
+    ldr_reading reading;    /* The reading that was last requested. */
 };
 
 /**
@@ -34,14 +36,15 @@ void ldr_init(ldr* lp, int send_pin, int read_pin1, int read_pin2)
     (*lp)->send_pin = send_pin;
     (*lp)->read_pin1 = read_pin1;
     (*lp)->read_pin2 = read_pin2;
+    (*lp)->pending = false;
 
     /* Create inputs and outputs. */
-    setup_gpio((*lp)->send_pin, OUTPUT, 0);
-    setup_gpio((*lp)->read_pin1, INPUT, 0);
-    setup_gpio((*lp)->read_pin2, INPUT, 0);
+    gpio_setup_pin((*lp)->send_pin, OUTPUT, 0);
+    gpio_setup_pin((*lp)->read_pin1, INPUT, 0);
+    gpio_setup_pin((*lp)->read_pin2, INPUT, 0);
 
     /* Initialise outputs. */
-    output_gpio((*lp)->send_pin, LOW);
+    gpio_output((*lp)->send_pin, LOW);
 }
 
 /**
@@ -54,25 +57,76 @@ void ldr_term(ldr* lp)
 }
 
 /**
- * This function returns true if the light dependant resistor on the arduino
- * made a reading that was the brightest reading in a series.
+ * This function tells the arduino to start making a reading and returns
+ * without waiting for it. The reading is tagged with the step positions
+ * provided to the function.
  */
-bool ldr_read(ldr l)
+void ldr_request(ldr* lp, long x_steps, long z_steps)
 {
-    bool highest = false;
+    /* Tell the arduino that we're ready for it to make a reading. */
+    gpio_output((*lp)->send_pin, HIGH);
 
-    do
+    /* Tag the reading with the position it was requested at. */
+    (*lp)->reading.brightest = false;
+    (*lp)->reading.x_steps = x_steps;
+    (*lp)->reading.z_steps = z_steps;
+    (*lp)->pending = true;
+}
+
+/**
+ * This function returns true if the arduino has finished making the reading
+ * that was last requested from the ldr supplied to it.
+ */
+bool ldr_is_ready(ldr l)
+{
+    return l->pending && gpio_input(l->read_pin1) == HIGH;
+}
+
+/**
+ * This function collects the reading that was last requested from the ldr
+ * supplied to it. If the arduino has not finished the reading yet, this
+ * function waits for it.
+ */
+ldr_reading ldr_complete(ldr* lp)
+{
+    struct timespec poll;   /* When the arduino was last checked. */
+
+    /* Nothing was requested so there is nothing to collect. */
+    if (!(*lp)->pending)
+        return (*lp)->reading;
+
+    /* Keep telling the arduino that we're ready for a reading until it has
+     * made one, waiting a little between checks. The wait is also what
+     * moves the virtual clock on to when the reading is made. */
+    gpio_output((*lp)->send_pin, HIGH);
+    while (gpio_input((*lp)->read_pin1) == LOW)
     {
-        /* Tell the arduino that we're ready for it to make a reading. */
-        output_gpio(l->send_pin, HIGH);
-   
-    /* Wait for the arduino made a reading. */
-    } while (input_gpio(l->read_pin1) == LOW);
+        start_timer(&poll);
+        wait_timer(poll, LDR_POLL_INTERVAL);
+        gpio_output((*lp)->send_pin, HIGH);
+    }
 
     /* Stop telling the arduino to make a reading. */
-    output_gpio(l->send_pin, LOW);
+    gpio_output((*lp)->send_pin, LOW);
+    (*lp)->pending = false;
 
-    /* Return whether the reading was the brightest out of any reading
+    /* Record whether the reading was the brightest out of any reading
      * so far. */
-    return input_gpio(l->read_pin2) == HIGH;
+    (*lp)->reading.brightest = gpio_input((*lp)->read_pin2) == HIGH;
+    trace_ldr((*lp)->reading.x_steps, (*lp)->reading.z_steps,
+              (*lp)->reading.brightest);
+
+    /* Return the tagged reading. */
+    return (*lp)->reading;
+}
+
+/**
+ * This function abandons the reading that was last requested from the ldr
+ * supplied to it.
+ */
+void ldr_cancel(ldr* lp)
+{
+    /* Stop telling the arduino to make a reading. */
+    gpio_output((*lp)->send_pin, LOW);
+    (*lp)->pending = false;
 }
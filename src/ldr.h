@@ -17,13 +17,30 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
-#include <pi-gpio.h>
+
+#include "gpio.h"
+#include "mycutils.h"
+
+/* This is the time, in nano-seconds, waited between checks of whether the
+ * arduino has finished a reading that is being waited for. */
+#define LDR_POLL_INTERVAL 1000000
 
 /**
  * This is the data structure of the ldr type.
  */
 typedef struct ldr_data* ldr;
 
+/**
+ * This is a reading made by the light dependant resistor. It is tagged with
+ * the step positions of the rack's axes at the time the reading was
+ * requested, so it can be collected after the rack has moved on.
+ */
+typedef struct {
+    bool brightest; /* Whether it was the brightest reading in a series. */
+    long x_steps;   /* The step position of the x axis when requested. */
+    long z_steps;   /* The step position of the z axis when requested. */
+} ldr_reading;
+
 /**
  * This function initialises the ldr supplied to it.
  */
@@ -35,9 +52,29 @@ void ldr_init(ldr* lp, int send_pin, int read_pin1, int read_pin2);
 void ldr_term(ldr* lp);
 
 /**
- * This function returns true if the light dependant resistor on the arduino
- * made a reading that was the brightest reading in a series.
+ * This function tells the arduino to start making a reading and returns
+ * without waiting for it. The reading is tagged with the step positions
+ * provided to the function.
+ */
+void ldr_request(ldr* lp, long x_steps, long z_steps);
+
+/**
+ * This function returns true if the arduino has finished making the reading
+ * that was last requested from the ldr supplied to it.
+ */
+bool ldr_is_ready(ldr l);
+
+/**
+ * This function collects the reading that was last requested from the ldr
+ * supplied to it. If the arduino has not finished the reading yet, this
+ * function waits for it.
+ */
+ldr_reading ldr_complete(ldr* lp);
+
+/**
+ * This function abandons the reading that was last requested from the ldr
+ * supplied to it.
  */
-bool ldr_read(ldr l);
+void ldr_cancel(ldr* lp);
 
 #endif // LDR_H
@@ -0,0 +1,290 @@
+/**
+ * light_map.c
+ *
+ * This file contains the internal data-structure and function definitions
+ * for the light_map type.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#include "light_map.h"
+
+/* These are the flags of a record in the light map's file. */
+#define LIGHT_MAP_BRIGHTEST 0x01
+#define LIGHT_MAP_CHOSEN 0x02
+
+/**
+ * This is a sample as it is stored in the light map's file.
+ */
+typedef struct {
+    int64_t time;       /* The time the reading was made. */
+    int16_t x;          /* The angle of the x axis. */
+    int16_t z;          /* The angle of the z axis. */
+    uint8_t flags;      /* Whether it was brightest and chosen. */
+    uint8_t unused[3];  /* Keeps every record the same size. */
+} light_map_record;
+
+/**
+ * This is what the light map knows about one position in one bin.
+ */
+typedef struct {
+    int x;              /* The angle of the x axis. */
+    int z;              /* The angle of the z axis. */
+    unsigned samples;   /* The number of readings made here. */
+    unsigned brightest; /* The number that were the brightest so far. */
+    unsigned chosen;    /* The number of searches that chose it. */
+} light_map_cell;
+
+/**
+ * This is the internal data-structure of the light_map type.
+ */
+struct light_map_data {
+
+    /* This is the file samples are appended to. */
+    FILE* fs;
+
+    /* These are the positions remembered for every season and time of
+     * day. */
+    light_map_cell cells[LIGHT_MAP_SEASONS][LIGHT_MAP_BINS][LIGHT_MAP_CELLS];
+
+    /* This is the number of positions used in every bin. */
+    int num_cells[LIGHT_MAP_SEASONS][LIGHT_MAP_BINS];
+};
+
+/**
+ * This function stores the season and time of day bin of the time provided
+ * to it in season and bin.
+ */
+void light_map_bin(time_t when, int* season, int* bin)
+{
+    struct tm local;    /* The local time. */
+
+    localtime_r(&when, &local);
+    *season = local.tm_mon / (12 / LIGHT_MAP_SEASONS);
+    *bin = (local.tm_hour * 60 + local.tm_min) / LIGHT_MAP_BIN_MINUTES;
+}
+
+/**
+ * This function adds a sample to the bins of the light map provided to it.
+ */
+void light_map_count(light_map* mp, light_sample sample)
+{
+    light_map_cell* cells;  /* The positions in the sample's bin. */
+    int* num_cells;         /* The number of positions in the bin. */
+    int season, bin, c;
+
+    /* Find the sample's bin. */
+    light_map_bin(sample.time, &season, &bin);
+    cells = (*mp)->cells[season][bin];
+    num_cells = &(*mp)->num_cells[season][bin];
+
+    /* Find the sample's position in the bin. */
+    for (c = 0; c < *num_cells; c++)
+    {
+        if (cells[c].x == sample.x && cells[c].z == sample.z)
+            break;
+    }
+
+    /* The position is new to the bin. If the bin is full, the position that
+     * has been chosen the least makes room for it. */
+    if (c == *num_cells)
+    {
+        if (*num_cells < LIGHT_MAP_CELLS)
+        {
+            (*num_cells)++;
+        }
+        else
+        {
+            c = 0;
+            for (int o = 1; o < LIGHT_MAP_CELLS; o++)
+            {
+                if (cells[o].chosen < cells[c].chosen)
+                    c = o;
+            }
+        }
+        cells[c] = (light_map_cell) { sample.x, sample.z, 0, 0, 0 };
+    }
+
+    /* Count the sample. */
+    cells[c].samples++;
+    if (sample.brightest)
+        cells[c].brightest++;
+    if (sample.chosen)
+        cells[c].chosen++;
+}
+
+/**
+ * This function initialises the light map provided to it, loading any
+ * samples already stored in the file at the path provided to it.
+ */
+void light_map_init(light_map* mp, char* fname)
+{
+    light_map_record record;    /* A record read from the file. */
+
+    /* Allocate memory to the light map. */
+    *mp = (light_map) malloc(sizeof(struct light_map_data));
+    memset((*mp)->num_cells, 0, sizeof((*mp)->num_cells));
+
+    /* Open the file, creating it if it doesn't exist yet. */
+    (*mp)->fs = openfs(fname, "a+b");
+    rewind((*mp)->fs);
+
+    /* Count every sample that is already in the file. */
+    while (fread(&record, sizeof(record), 1, (*mp)->fs) == 1)
+    {
+        light_map_count(mp, (light_sample) {
+            .time = (time_t) record.time,
+            .x = record.x,
+            .z = record.z,
+            .brightest = record.flags & LIGHT_MAP_BRIGHTEST,
+            .chosen = record.flags & LIGHT_MAP_CHOSEN
+        });
+    }
+}
+
+/**
+ * This function terminates the light map provided to it.
+ */
+void light_map_term(light_map* mp)
+{
+    /* Close the file and de-allocate memory from the light map. */
+    closefs((*mp)->fs);
+    free(*mp);
+}
+
+/**
+ * This function adds a sample to the light map provided to it and appends
+ * it to the light map's file.
+ */
+void light_map_add(light_map* mp, light_sample sample)
+{
+    light_map_record record;    /* The record written to the file. */
+
+    /* Count the sample. */
+    light_map_count(mp, sample);
+
+    /* Append the sample to the file. */
+    memset(&record, 0, sizeof(record));
+    record.time = (int64_t) sample.time;
+    record.x = (int16_t) sample.x;
+    record.z = (int16_t) sample.z;
+    record.flags = (sample.brightest ? LIGHT_MAP_BRIGHTEST : 0)
+                 | (sample.chosen ? LIGHT_MAP_CHOSEN : 0);
+    fwrite(&record, sizeof(record), 1, (*mp)->fs);
+    fflush((*mp)->fs);
+}
+
+/**
+ * This function returns the best position in the bin of the light map
+ * provided to it, or best if none of the bin's positions are better.
+ */
+light_map_cell* light_map_best(light_map m, int season, int bin,
+                               light_map_cell* best)
+{
+    light_map_cell* cells;  /* The positions in the bin. */
+    int c;
+
+    /* Bins wrap around midnight. */
+    bin = (bin + LIGHT_MAP_BINS) % LIGHT_MAP_BINS;
+    cells = m->cells[season][bin];
+
+    for (c = 0; c < m->num_cells[season][bin]; c++)
+    {
+        /* The best position is the one chosen the most, then the one that
+         * was brightest the most. */
+        if (best == NULL
+            || cells[c].chosen > best->chosen
+            || (cells[c].chosen == best->chosen
+                && cells[c].brightest > best->brightest))
+            best = &cells[c];
+    }
+
+    return best;
+}
+
+/**
+ * This function stores the position that is predicted to be the brightest
+ * at the time provided to it in x and z. It returns false if the light map
+ * has no samples near that time of day in that season.
+ */
+bool light_map_predict(light_map m, time_t when, int* x, int* z)
+{
+    light_map_cell* best;   /* The best position found. */
+    int season, bin, offset;
+
+    /* Find the bin of the time. */
+    light_map_bin(when, &season, &bin);
+
+    /* Check the bin, then the bins either side of it, moving further away
+     * until one of them knows something. */
+    best = light_map_best(m, season, bin, NULL);
+    for (offset = 1; best == NULL && offset <= 2; offset++)
+    {
+        best = light_map_best(m, season, bin - offset, best);
+        best = light_map_best(m, season, bin + offset, best);
+    }
+
+    /* Check if anything is known. */
+    if (best == NULL)
+        return false;
+
+    *x = best->x;
+    *z = best->z;
+    return true;
+}
+
+/**
+ * This function adds the number of searches in the bin of the light map
+ * provided to it to total, and the number of them that chose the position
+ * provided to it to chosen.
+ */
+void light_map_tally(light_map m, int season, int bin, int x, int z,
+                     unsigned* chosen, unsigned* total)
+{
+    light_map_cell* cells;  /* The positions in the bin. */
+    int c;
+
+    /* Bins wrap around midnight. */
+    bin = (bin + LIGHT_MAP_BINS) % LIGHT_MAP_BINS;
+    cells = m->cells[season][bin];
+
+    /* Every search chooses exactly one position. */
+    for (c = 0; c < m->num_cells[season][bin]; c++)
+    {
+        *total += cells[c].chosen;
+        if (cells[c].x == x && cells[c].z == z)
+            *chosen += cells[c].chosen;
+    }
+}
+
+/**
+ * This function returns the fraction of past light searches near the time
+ * of day provided to it, in the same season, that chose the position
+ * provided to it. It returns 0 if nothing is known about that time.
+ */
+double light_map_confidence(light_map m, time_t when, int x, int z)
+{
+    unsigned chosen;    /* The number of searches that chose the position. */
+    unsigned total;     /* The number of searches. */
+    int season, bin, offset;
+
+    /* Find the bin of the time. */
+    light_map_bin(when, &season, &bin);
+
+    /* Use the same bins as light_map_predict(). */
+    chosen = 0;
+    total = 0;
+    light_map_tally(m, season, bin, x, z, &chosen, &total);
+    for (offset = 1; total == 0 && offset <= 2; offset++)
+    {
+        light_map_tally(m, season, bin - offset, x, z, &chosen, &total);
+        light_map_tally(m, season, bin + offset, x, z, &chosen, &total);
+    }
+
+    /* Check if anything is known. */
+    if (total == 0)
+        return 0;
+
+    return (double) chosen / total;
+}
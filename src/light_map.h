@@ -0,0 +1,86 @@
+/**
+ * light_map.h
+ *
+ * This file contains the public data-structure and function prototype
+ * declarations for the light_map type.
+ *
+ * The light_map type remembers every reading made during light searches
+ * in a compact file, and uses them to predict which position of the rack
+ * will be the brightest at a given time of day and season.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#ifndef light_map_h
+#define light_map_h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "mycutils.h"
+
+/* This is the number of seasons the year is divided into. */
+#define LIGHT_MAP_SEASONS 4
+
+/* This is the number of minutes covered by each time of day bin. */
+#define LIGHT_MAP_BIN_MINUTES 30
+
+/* This is the number of time of day bins in a day. */
+#define LIGHT_MAP_BINS (24 * 60 / LIGHT_MAP_BIN_MINUTES)
+
+/* This is the number of different positions remembered in each bin. */
+#define LIGHT_MAP_CELLS 8
+
+/**
+ * This is a reading made during a light search.
+ */
+typedef struct {
+    time_t time;    /* The time the reading was made. */
+    int x;          /* The angle of the x axis. */
+    int z;          /* The angle of the z axis. */
+    bool brightest; /* Whether it was the brightest reading in its series. */
+    bool chosen;    /* Whether the search chose this position. */
+} light_sample;
+
+/**
+ * This is the data-structure of the light_map type.
+ */
+typedef struct light_map_data* light_map;
+
+/**
+ * This function initialises the light map provided to it, loading any
+ * samples already stored in the file at the path provided to it.
+ */
+void light_map_init(light_map* mp, char* fname);
+
+/**
+ * This function terminates the light map provided to it.
+ */
+void light_map_term(light_map* mp);
+
+/**
+ * This function adds a sample to the light map provided to it and appends
+ * it to the light map's file.
+ */
+void light_map_add(light_map* mp, light_sample sample);
+
+/**
+ * This function stores the position that is predicted to be the brightest
+ * at the time provided to it in x and z. It returns false if the light map
+ * has no samples near that time of day in that season.
+ */
+bool light_map_predict(light_map m, time_t when, int* x, int* z);
+
+/**
+ * This function returns the fraction of past light searches near the time
+ * of day provided to it, in the same season, that chose the position
+ * provided to it. It returns 0 if nothing is known about that time.
+ */
+double light_map_confidence(light_map m, time_t when, int x, int z);
+
+#endif
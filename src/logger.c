@@ -0,0 +1,156 @@
+/**
+ * logger.c
+ *
+ * This file contains the internal data-structure and function definitions
+ * for the logger.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#include "logger.h"
+
+/**
+ * These are the names of the levels of log record.
+ */
+char* logger_level_names[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+/**
+ * This is a log record waiting to be written.
+ */
+typedef struct {
+    uint64_t time;                          /* When it was made, in
+                                             * monotonic nano-seconds. */
+    int level;                              /* The level of the record. */
+    int num_fields;                         /* The number of fields. */
+    log_field fields[LOGGER_MAX_FIELDS];    /* The fields. */
+} log_record;
+
+/**
+ * This is the state of the logger. Any thread can put records in the ring,
+ * while its writer writes them to the log file.
+ */
+struct {
+    atomic_bool running;            /* Whether records are kept. */
+    record_ring ring;               /* The ring. */
+    uint64_t start;                 /* When the logger started, in
+                                     * monotonic nano-seconds. */
+    FILE* fs;                       /* The log file. */
+} logger_state = { .running = false };
+
+/**
+ * This function puts a record with the level and fields provided to it in
+ * the ring, or drops it if the ring is full. It never waits, so it can be
+ * called from any thread.
+ */
+void logger_put(int level, log_field* fields, size_t num_fields)
+{
+    log_record record;  /* The record. */
+    size_t f;
+
+    if (!atomic_load_explicit(&logger_state.running, memory_order_acquire))
+        return;
+
+    /* Fill the record in, keeping as many fields as fit, and hand it to the
+     * ring. */
+    if (num_fields > LOGGER_MAX_FIELDS)
+        num_fields = LOGGER_MAX_FIELDS;
+    record.time = monotonic_nanos();
+    record.level = level;
+    record.num_fields = (int) num_fields;
+    for (f = 0; f < num_fields; f++)
+        record.fields[f] = fields[f];
+    record_ring_put(logger_state.ring, &record);
+}
+
+/**
+ * This function is handed the records of the ring by its writer. It writes
+ * the record provided to it to the log file provided to it, as the seconds
+ * since the logger started, the level and then every field as name=value,
+ * or flushes the file if there is no record.
+ */
+void logger_write(void* record, void* arg)
+{
+    log_record* rec = (log_record*) record;     /* The record. */
+    FILE* fs = (FILE*) arg;                     /* The log file. */
+    log_field* f;                               /* The field being
+                                                 * written. */
+    int i;
+
+    if (rec == NULL)
+    {
+        fflush(fs);
+        return;
+    }
+
+    fprintf(fs, "t=%.6f level=%s", (rec->time - logger_state.start) / 1e9,
+            logger_level_names[rec->level]);
+    for (i = 0; i < rec->num_fields; i++)
+    {
+        f = &rec->fields[i];
+        switch (f->type)
+        {
+            case LOG_INT_FIELD :
+                fprintf(fs, " %s=%lld", f->name, f->value.i);
+                break;
+            case LOG_DOUBLE_FIELD :
+                fprintf(fs, " %s=%g", f->name, f->value.d);
+                break;
+            case LOG_STR_FIELD :
+                fprintf(fs, " %s=\"%s\"", f->name, f->value.s);
+                break;
+        }
+    }
+    fputc('\n', fs);
+}
+
+/**
+ * This function starts the logger writing to the file provided to it.
+ */
+void logger_start(char* fname)
+{
+    char* tstamp;   /* The time the logger started. */
+
+    if (atomic_load(&logger_state.running))
+        return;
+
+    /* Open the log file and mark where this run starts in it. */
+    if ((logger_state.fs = fopen(fname, "a")) == NULL)
+    {
+        fprintf(stderr, "[ %s ] ERROR: In function logger_start(): "
+                        "Could not open %s\n",
+                (tstamp = timestamp()), fname);
+        free(tstamp);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(logger_state.fs, "# %s\n", (tstamp = timestamp()));
+    free(tstamp);
+
+    /* Start the ring writing to it. */
+    logger_state.start = monotonic_nanos();
+    record_ring_init(&logger_state.ring, LOGGER_RING_CAPACITY,
+                     sizeof(log_record), LOGGER_WRITER_SLEEP, logger_write,
+                     logger_state.fs);
+    atomic_store(&logger_state.running, true);
+}
+
+/**
+ * This function writes whatever the logger still has to its file and
+ * stops it. It must only be called once no other thread is logging.
+ */
+void logger_stop()
+{
+    uint64_t num_dropped;   /* The records the ring had no room for. */
+
+    if (!atomic_exchange(&logger_state.running, false))
+        return;
+
+    /* Write whatever the ring still has. */
+    num_dropped = record_ring_get_num_dropped(logger_state.ring);
+    record_ring_term(&logger_state.ring);
+
+    if (num_dropped > 0)
+        fprintf(logger_state.fs, "# %llu records dropped\n",
+                (unsigned long long) num_dropped);
+    fclose(logger_state.fs);
+}
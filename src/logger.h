@@ -0,0 +1,143 @@
+/**
+ * logger.h
+ *
+ * This file contains the public data-structure and function prototype
+ * declarations for the logger, as well as the macros that make log
+ * records.
+ *
+ * A log record is an event and a few named fields, rather than a formatted
+ * string, such as:
+ *
+ *     LOG_INFO("search_reading", LOG_INT("position", 3),
+ *                                LOG_STR("result", "dimmer"));
+ *
+ * Records below LOGGER_LEVEL are compiled out completely, so their fields
+ * aren't even worked out. The rest are put into a lock-free ring by
+ * whichever thread makes them, without formatting anything or making a
+ * system call, and a background thread writes them to the log file. If the
+ * ring is ever full, records are dropped rather than holding the rover up.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#ifndef logger_h
+#define logger_h
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "mycutils.h"
+#include "record_ring.h"
+
+/* These are the levels of log record. They are numbers rather than an
+ * enumeration so the preprocessor can compare them. */
+#define LOGGER_DEBUG 0
+#define LOGGER_INFO 1
+#define LOGGER_WARN 2
+#define LOGGER_ERROR 3
+#define LOGGER_OFF 4
+
+/* This is the lowest level of record that is compiled in. The build sets
+ * it from ROVER_LOG_LEVEL. */
+#ifndef LOGGER_LEVEL
+#define LOGGER_LEVEL LOGGER_INFO
+#endif
+
+/* This is the number of records the ring can hold. It must be a power of
+ * two. */
+#define LOGGER_RING_CAPACITY 1024
+
+/* This is the most fields a record can have, counting its event. */
+#define LOGGER_MAX_FIELDS 6
+
+/* This is the time, in nano-seconds, the writer sleeps for when the ring
+ * is empty. */
+#define LOGGER_WRITER_SLEEP 20000000
+
+/**
+ * These are the types of value a field can have.
+ */
+enum LogFieldType { LOG_INT_FIELD, LOG_DOUBLE_FIELD, LOG_STR_FIELD };
+
+/**
+ * This is a named field of a log record. The names, and the values of
+ * string fields, are not copied, so they must last as long as the program
+ * does, as string literals do.
+ */
+typedef struct {
+    const char* name;           /* The name of the field. */
+    enum LogFieldType type;     /* The type of its value. */
+    union {
+        long long i;            /* An integer value. */
+        double d;               /* A real value. */
+        const char* s;          /* A string value. */
+    } value;
+} log_field;
+
+/* These make the fields of a record. */
+#define LOG_INT(name, v) \
+    ((log_field) { (name), LOG_INT_FIELD, { .i = (long long) (v) } })
+#define LOG_DOUBLE(name, v) \
+    ((log_field) { (name), LOG_DOUBLE_FIELD, { .d = (double) (v) } })
+#define LOG_STR(name, v) \
+    ((log_field) { (name), LOG_STR_FIELD, { .s = (v) } })
+
+/* This makes a record at a level, with the event as its first field. */
+#define LOG_AT(level, event, ...) \
+    logger_put((level), \
+        (log_field[]) { LOG_STR("event", (event)), ##__VA_ARGS__ }, \
+        sizeof((log_field[]) { LOG_STR("event", (event)), ##__VA_ARGS__ }) \
+            / sizeof(log_field))
+
+/* These make records at each level, or nothing if the level is compiled
+ * out. */
+#if LOGGER_LEVEL <= LOGGER_DEBUG
+#define LOG_DEBUG(event, ...) LOG_AT(LOGGER_DEBUG, event, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(event, ...) ((void) 0)
+#endif
+
+#if LOGGER_LEVEL <= LOGGER_INFO
+#define LOG_INFO(event, ...) LOG_AT(LOGGER_INFO, event, ##__VA_ARGS__)
+#else
+#define LOG_INFO(event, ...) ((void) 0)
+#endif
+
+#if LOGGER_LEVEL <= LOGGER_WARN
+#define LOG_WARN(event, ...) LOG_AT(LOGGER_WARN, event, ##__VA_ARGS__)
+#else
+#define LOG_WARN(event, ...) ((void) 0)
+#endif
+
+#if LOGGER_LEVEL <= LOGGER_ERROR
+#define LOG_ERROR(event, ...) LOG_AT(LOGGER_ERROR, event, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(event, ...) ((void) 0)
+#endif
+
+/**
+ * This function starts the logger writing to the file provided to it,
+ * appending to it if it already exists. Records made while the logger
+ * isn't running are thrown away.
+ */
+void logger_start(char* fname);
+
+/**
+ * This function writes whatever the logger still has to its file and
+ * stops it. It must only be called once no other thread is logging.
+ */
+void logger_stop();
+
+/**
+ * This function puts a record with the level and fields provided to it in
+ * the ring. It is called by the LOG_ macros, which should be used instead.
+ */
+void logger_put(int level, log_field* fields, size_t num_fields);
+
+#endif
@@ -3,6 +3,14 @@
  *
  * This file contains the main function for the solar-rover program.
  *
+ * The program can be run with these options:
+ *   --sim          Simulate the gpio pins.
+ *   --virtual      Run the timers on the virtual clock.
+ *   --record FILE  Record everything that comes into the rover to FILE.
+ *   --replay FILE  Replay what was recorded in FILE.
+ *   --speed X      Replay X times as fast as it was recorded, or as fast as
+ *                  possible if X is 0.
+ *
  * Version: 1.0.0
  * Author(s): Richard Gale
  */
@@ -11,13 +19,48 @@
 
 #include "rover.h"
 
-int main()
+/**
+ * This function prints how to run the program and exits.
+ */
+void usage(char* prog)
+{
+    char* tstamp;   /* The time of the error. */
+
+    fprintf(stderr, "[ %s ] ERROR: usage: %s [--sim] [--virtual] "
+                    "[--record FILE | --replay FILE [--speed X]]\n",
+            (tstamp = timestamp()), prog);
+    free(tstamp);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv)
 {
-    rover r;    /* The solar rover. */
+    rover r;                                    /* The solar rover. */
+    rover_options opts = ROVER_DEFAULT_OPTIONS; /* How to run it. */
+    int a;
+
+    /* Read the options. */
+    for (a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "--sim") == 0)
+            opts.sim = true;
+        else if (strcmp(argv[a], "--virtual") == 0)
+            opts.virtual_clock = true;
+        else if (strcmp(argv[a], "--record") == 0 && a + 1 < argc)
+            opts.record_file = argv[++a];
+        else if (strcmp(argv[a], "--replay") == 0 && a + 1 < argc)
+            opts.replay_file = argv[++a];
+        else if (strcmp(argv[a], "--speed") == 0 && a + 1 < argc)
+            opts.speed = atof(argv[++a]);
+        else
+            usage(argv[0]);
+    }
+    if (opts.record_file != NULL && opts.replay_file != NULL)
+        usage(argv[0]);
 
     /* Initialise the rover. */
     fprintf(stdout, "Setting up the rover...\n");
-    rover_init(&r);
+    rover_init(&r, opts);
 
     /* Run the rover. */
     fprintf(stdout, "Running the rover...\n");
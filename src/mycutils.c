@@ -22,6 +22,149 @@ double map(double x, double in_min,  double in_max,
 
 /********************************* Time **************************************/
 
+/* This is the clock timers are running on. */
+_Atomic enum clocks current_clock = REAL_CLOCK;
+
+/* This is the time of the virtual clock, in nano-seconds. */
+_Atomic uint64_t virtual_nanos = 0;
+
+/* This is the calendar time when the virtual clock was at zero. */
+time_t virtual_epoch = 0;
+
+/* This is told about every decision check_timer() makes, and can change
+ * it. */
+bool (*timer_hook)(uint64_t wait_time, bool elapsed) = NULL;
+
+/**
+ * This function converts the timespec provided to it to nano-seconds.
+ */
+uint64_t timespec_to_nanos(struct timespec ts)
+{
+    return (uint64_t) ts.tv_sec * NANOS_PER_SEC + ts.tv_nsec;
+}
+
+/**
+ * This function makes every timer run on the clock provided to it. The
+ * virtual clock carries on from the time the real clock is at, so timers
+ * that were already started keep working.
+ */
+void use_clock(enum clocks c)
+{
+    struct timespec now;    /* The time on the real clock. */
+
+    if (c == VIRTUAL_CLOCK && current_clock != VIRTUAL_CLOCK)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        atomic_store(&virtual_nanos, timespec_to_nanos(now));
+        virtual_epoch = time(NULL) - now.tv_sec;
+    }
+    atomic_store(&current_clock, c);
+}
+
+/**
+ * This function returns the clock that timers are running on.
+ */
+enum clocks get_clock()
+{
+    return atomic_load(&current_clock);
+}
+
+/**
+ * This function stores the current time of the clock timers are running on
+ * in the timespec provided to it.
+ */
+void get_time(struct timespec* ts)
+{
+    uint64_t nanos;     /* The time of the virtual clock. */
+
+    if (atomic_load(&current_clock) == REAL_CLOCK)
+    {
+        clock_gettime(CLOCK_MONOTONIC, ts);
+        return;
+    }
+
+    nanos = atomic_load(&virtual_nanos);
+    ts->tv_sec = nanos / NANOS_PER_SEC;
+    ts->tv_nsec = nanos % NANOS_PER_SEC;
+}
+
+/**
+ * This function returns the nano-seconds the system's monotonic clock is
+ * at.
+ */
+uint64_t monotonic_nanos()
+{
+    struct timespec now;    /* The current time. */
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return timespec_to_nanos(now);
+}
+
+/**
+ * This function returns the current calendar time. On the virtual clock it
+ * moves on as fast as the virtual clock does.
+ */
+time_t wall_time()
+{
+    if (atomic_load(&current_clock) == REAL_CLOCK)
+        return time(NULL);
+
+    return virtual_epoch + atomic_load(&virtual_nanos) / NANOS_PER_SEC;
+}
+
+/**
+ * This function sets the calendar time of the virtual clock to the time
+ * provided to it, without moving any timers. It does nothing on the real
+ * clock.
+ */
+void set_wall_time(time_t t)
+{
+    if (atomic_load(&current_clock) == VIRTUAL_CLOCK)
+        virtual_epoch = t - atomic_load(&virtual_nanos) / NANOS_PER_SEC;
+}
+
+/**
+ * This function moves the virtual clock to the time, in nano-seconds,
+ * provided to it, so a run can start from the same time every time. The
+ * calendar time moves with it. It does nothing on the real clock.
+ */
+void reset_virtual_clock(uint64_t nanos)
+{
+    if (atomic_load(&current_clock) == VIRTUAL_CLOCK)
+        atomic_store(&virtual_nanos, nanos);
+}
+
+/**
+ * This function waits until a number of nano-seconds equal to wait_time
+ * has elapsed since start. On the real clock the thread sleeps rather than
+ * spinning. On the virtual clock it doesn't wait at all, it moves the clock
+ * forward to the end of the wait instead, unless another thread has already
+ * moved it further.
+ */
+void wait_timer(struct timespec start, uint64_t wait_time)
+{
+    uint64_t deadline;      /* When the wait ends, in nano-seconds. */
+    uint64_t now;           /* The time of the virtual clock. */
+    struct timespec end;    /* When the wait ends. */
+
+    deadline = timespec_to_nanos(start) + wait_time;
+    if (atomic_load(&current_clock) == VIRTUAL_CLOCK)
+    {
+        now = atomic_load(&virtual_nanos);
+        while (now < deadline
+               && !atomic_compare_exchange_weak(&virtual_nanos, &now,
+                                                deadline));
+        return;
+    }
+
+    /* Sleep until the end of the wait, carrying on if a signal wakes the
+     * thread early. */
+    end.tv_sec = deadline / NANOS_PER_SEC;
+    end.tv_nsec = deadline % NANOS_PER_SEC;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &end, NULL)
+           == EINTR);
+}
+
 /**
  * This function returns true if a number of nano-seconds equal to or greater
  * than wait_time has elapsed since start.
@@ -34,12 +177,17 @@ bool check_timer(struct timespec start, uint64_t wait_time)
     struct timespec elapsed;            /* The time elapsed since start. */
 
     /* Obtaining the current time. */
-    clock_gettime(CLOCK_REALTIME, &current);
+    get_time(&current);
 
     /* Calculating the elapsed time. */
     elapsed.tv_sec = current.tv_sec - start.tv_sec;
     elapsed.tv_nsec = current.tv_nsec - start.tv_nsec;
 
+    /* Letting the hook decide whether the time has elapsed. */
+    if (timer_hook != NULL)
+        return timer_hook(wait_time,
+            (elapsed.tv_sec * NANOS_PER_SEC) + elapsed.tv_nsec >= wait_time);
+
     /* Checking whether the time hasn't elapsed. */
     if ((elapsed.tv_sec * NANOS_PER_SEC) + elapsed.tv_nsec < wait_time)
         return NOT_ELAPSED;
@@ -48,6 +196,16 @@ bool check_timer(struct timespec start, uint64_t wait_time)
     return HAS_ELAPSED;
 }
 
+/**
+ * This function makes check_timer() pass every decision it makes through
+ * the function provided to it, which returns the decision to use. NULL
+ * removes it.
+ */
+void set_timer_hook(bool (*hook)(uint64_t wait_time, bool elapsed))
+{
+    timer_hook = hook;
+}
+
 /**
  * This function obtains the current time and stores it in the timespec
  * that was provided to it.
@@ -56,8 +214,16 @@ void start_timer(struct timespec* ts)
 {
     char* tstamp;
 
+    /* Obtaining the current time from the virtual clock, which can't
+     * fail. */
+    if (get_clock() == VIRTUAL_CLOCK)
+    {
+        get_time(ts);
+        return;
+    }
+
     /* Obtaining the current time.*/
-    if ((clock_gettime(CLOCK_REALTIME, ts)) != -1)
+    if ((clock_gettime(CLOCK_MONOTONIC, ts)) != -1)
         return;
         
     /* An error occured so we are printing an error message. */
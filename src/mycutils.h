@@ -22,6 +22,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <termios.h>
+#include <stdatomic.h>
 
 /**
  * This is the number of nanoseconds in a second.
@@ -46,12 +47,79 @@ double map(double x, double in_min,  double in_max,
 
 /********************************* Time **************************************/
 
+/**
+ * These are the clocks that timers can run on.
+ */
+enum clocks {
+    REAL_CLOCK,     /* The system's monotonic clock. */
+    VIRTUAL_CLOCK   /* A clock that only moves when something waits on it,
+                     * jumping straight to the end of the wait. */
+    };
+
+/**
+ * This function makes every timer run on the clock provided to it. The
+ * virtual clock carries on from the time the real clock is at.
+ */
+void use_clock(enum clocks c);
+
+/**
+ * This function returns the clock that timers are running on.
+ */
+enum clocks get_clock();
+
+/**
+ * This function stores the current time of the clock timers are running on
+ * in the timespec provided to it.
+ */
+void get_time(struct timespec* ts);
+
+/**
+ * This function returns the nano-seconds the system's monotonic clock is
+ * at. Whatever the rover times is timed on it, even while the timers run
+ * on the virtual clock.
+ */
+uint64_t monotonic_nanos();
+
+/**
+ * This function returns the current calendar time. On the virtual clock it
+ * moves on as fast as the virtual clock does.
+ */
+time_t wall_time();
+
+/**
+ * This function sets the calendar time of the virtual clock to the time
+ * provided to it, without moving any timers. It does nothing on the real
+ * clock.
+ */
+void set_wall_time(time_t t);
+
+/**
+ * This function moves the virtual clock to the time, in nano-seconds,
+ * provided to it, so a run can start from the same time every time. The
+ * calendar time moves with it. It does nothing on the real clock.
+ */
+void reset_virtual_clock(uint64_t nanos);
+
+/**
+ * This function waits until a number of nano-seconds equal to wait_time
+ * has elapsed since start. On the virtual clock it doesn't wait, it moves
+ * the clock forward to the end of the wait instead.
+ */
+void wait_timer(struct timespec start, uint64_t wait_time);
+
 /**
  * This function returns true if a number of nano-seconds equal to or greater
  * than wait_time has elapsed since start.
  */
 bool check_timer(struct timespec ts_start, uint64_t wait_time);
 
+/**
+ * This function makes check_timer() pass every decision it makes through
+ * the function provided to it, which returns the decision to use. NULL
+ * removes it.
+ */
+void set_timer_hook(bool (*hook)(uint64_t wait_time, bool elapsed));
+
 /**
  * This function obtains the current time, storing it in the timespec
  * provided to it.
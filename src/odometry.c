@@ -0,0 +1,211 @@
+/**
+ * odometry.c
+ *
+ * This file contains the internal data-structure and function definitions
+ * for the odometry type.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#include "odometry.h"
+
+/**
+ * This is the internal data of the odometry type.
+ */
+struct odometry_data {
+    int duty_cycle_max;         /* The largest duty cycle of the motors. */
+    int track_width;            /* The distance between the wheels, mm. */
+
+    /* These turn the duty cycles of the left and right motors into wheel
+     * speeds in millimetres per second, one entry per duty cycle. */
+    double* lspeed_table;
+    double* rspeed_table;
+
+    int lduty_cycle;            /* The left motor's current duty cycle. */
+    int rduty_cycle;            /* The right motor's current duty cycle. */
+    struct timespec last_update;/* When the duty cycles were recorded. */
+
+    /* The pose is written by the one thread that updates the odometry and
+     * can be read by any other. The sequence number is odd while it is
+     * being written, so readers can tell when they need to read again. */
+    atomic_uint seq;
+    odometry_pose pose;
+};
+
+/**
+ * This function fills the table provided to it with the wheel speeds a
+ * motor with the calibration provided to it reaches at every duty cycle.
+ */
+void build_speed_table(double* table, int duty_cycle_max,
+                       motor_calibration cal)
+{
+    int d;
+
+    for (d = 0; d <= duty_cycle_max; d++)
+    {
+        /* The wheel doesn't turn inside the deadband. */
+        if (d <= cal.deadband)
+            table[d] = 0;
+        else
+            table[d] = cal.max_speed * pow((double) (d - cal.deadband)
+                                        / (duty_cycle_max - cal.deadband),
+                                        cal.gamma);
+    }
+}
+
+/**
+ * This function returns the wheel speed the table provided to it gives for
+ * a duty cycle.
+ */
+double lookup_speed(double* table, int duty_cycle_max, int duty_cycle)
+{
+    int entry;  /* The entry of the table for the duty cycle. */
+
+    entry = abs(duty_cycle);
+    if (entry > duty_cycle_max)
+        entry = duty_cycle_max;
+
+    /* Negative duty cycles turn the wheel backwards. */
+    return duty_cycle < 0 ? -table[entry] : table[entry];
+}
+
+/**
+ * This function publishes the pose provided to it as the pose of the
+ * odometry provided to it.
+ */
+void publish_pose(odometry* op, odometry_pose pose)
+{
+    unsigned seq;   /* The sequence number before the pose is written. */
+
+    seq = atomic_load_explicit(&(*op)->seq, memory_order_relaxed);
+    atomic_store_explicit(&(*op)->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    (*op)->pose = pose;
+    atomic_store_explicit(&(*op)->seq, seq + 2, memory_order_release);
+}
+
+/**
+ * This function initialises the odometry provided to it. The wheels are
+ * track_width millimetres apart and are driven by motors whose duty
+ * cycles go up to duty_cycle_max.
+ */
+void odometry_init(odometry* op, int duty_cycle_max, int track_width,
+                   motor_calibration lcal, motor_calibration rcal)
+{
+    /* Allocate memory to the odometry. */
+    *op = (odometry) malloc(sizeof(struct odometry_data));
+    (*op)->lspeed_table = (double*) malloc(sizeof(double) * (duty_cycle_max + 1));
+    (*op)->rspeed_table = (double*) malloc(sizeof(double) * (duty_cycle_max + 1));
+
+    (*op)->duty_cycle_max = duty_cycle_max;
+    (*op)->track_width = track_width;
+    odometry_set_calibration(op, lcal, rcal);
+
+    /* Start at the origin with the motors stopped. */
+    (*op)->lduty_cycle = 0;
+    (*op)->rduty_cycle = 0;
+    atomic_init(&(*op)->seq, 0);
+    odometry_reset(op);
+}
+
+/**
+ * This function terminates the odometry provided to it.
+ */
+void odometry_term(odometry* op)
+{
+    /* De-allocate memory from the odometry. */
+    free((*op)->lspeed_table);
+    free((*op)->rspeed_table);
+    free(*op);
+}
+
+/**
+ * This function sets the calibrations of the motors the odometry provided
+ * to it models.
+ */
+void odometry_set_calibration(odometry* op, motor_calibration lcal,
+                                            motor_calibration rcal)
+{
+    build_speed_table((*op)->lspeed_table, (*op)->duty_cycle_max, lcal);
+    build_speed_table((*op)->rspeed_table, (*op)->duty_cycle_max, rcal);
+}
+
+/**
+ * This function moves the pose of the odometry provided to it back to the
+ * origin.
+ */
+void odometry_reset(odometry* op)
+{
+    odometry_pose origin = { 0, 0, 0 };
+
+    publish_pose(op, origin);
+    start_timer(&(*op)->last_update);
+}
+
+/**
+ * This function adds the movement made since the last update to the pose
+ * of the odometry provided to it, then records the duty cycles the motors
+ * run at from now on.
+ */
+void odometry_update(odometry* op, int lduty_cycle, int rduty_cycle)
+{
+    struct timespec now;    /* The time of this update. */
+    odometry_pose pose;     /* The new pose. */
+    double dt;              /* The seconds since the last update. */
+    double lspeed;          /* The speed of the left wheel. */
+    double rspeed;          /* The speed of the right wheel. */
+    double v;               /* The speed of the middle of the axle. */
+    double w;               /* The rate the rover is turning. */
+    double mid_heading;     /* The heading half way through the update. */
+
+    /* Work out how long the last duty cycles were running for. */
+    get_time(&now);
+    dt = (now.tv_sec - (*op)->last_update.tv_sec)
+        + (now.tv_nsec - (*op)->last_update.tv_nsec) / 1e9;
+    (*op)->last_update = now;
+
+    /* Work out how fast the rover was going and turning. */
+    lspeed = lookup_speed((*op)->lspeed_table, (*op)->duty_cycle_max,
+                          (*op)->lduty_cycle);
+    rspeed = lookup_speed((*op)->rspeed_table, (*op)->duty_cycle_max,
+                          (*op)->rduty_cycle);
+    v = (lspeed + rspeed) / 2;
+    w = (rspeed - lspeed) / (*op)->track_width;
+
+    /* Move along the arc, using the heading half way along it. */
+    if (dt > 0 && (lspeed != 0 || rspeed != 0))
+    {
+        pose = (*op)->pose;
+        mid_heading = pose.heading + w * dt / 2;
+        pose.x += v * dt * cos(mid_heading);
+        pose.y += v * dt * sin(mid_heading);
+        pose.heading = remainder(pose.heading + w * dt, 2 * M_PI);
+        publish_pose(op, pose);
+    }
+
+    /* Record the duty cycles that run from now on. */
+    (*op)->lduty_cycle = lduty_cycle;
+    (*op)->rduty_cycle = rduty_cycle;
+}
+
+/**
+ * This function returns the pose of the odometry provided to it. It never
+ * waits for a lock, so it can be called from any thread.
+ */
+odometry_pose odometry_get_pose(odometry o)
+{
+    odometry_pose pose; /* A copy of the pose. */
+    unsigned before;    /* The sequence number before the copy. */
+    unsigned after;     /* The sequence number after the copy. */
+
+    /* Copy the pose until it wasn't being written during the copy. */
+    do {
+        before = atomic_load_explicit(&o->seq, memory_order_acquire);
+        pose = o->pose;
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&o->seq, memory_order_relaxed);
+    } while (before != after || (before & 1));
+
+    return pose;
+}
@@ -0,0 +1,77 @@
+/*
+ * odometry.h
+ *
+ * This file contains the public data-structure and public function prototype
+ * declarations for the odometry type.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#ifndef odometry_h
+#define odometry_h
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+#include <math.h>
+
+#include "brushed_motor.h"
+#include "mycutils.h"
+
+/**
+ * This is an estimate of where the rover is, relative to where it was when
+ * the estimate started.
+ */
+typedef struct {
+    double x;       /* The distance forwards, in millimetres. */
+    double y;       /* The distance to the left, in millimetres. */
+    double heading; /* The anticlockwise rotation, in radians from -pi to pi. */
+} odometry_pose;
+
+/**
+ * This is the data-structure of the odometry type.
+ */
+typedef struct odometry_data* odometry;
+
+/**
+ * This function initialises the odometry provided to it. The wheels are
+ * track_width millimetres apart and are driven by motors whose duty
+ * cycles go up to duty_cycle_max.
+ */
+void odometry_init(odometry* op, int duty_cycle_max, int track_width,
+                   motor_calibration lcal, motor_calibration rcal);
+
+/**
+ * This function terminates the odometry provided to it.
+ */
+void odometry_term(odometry* op);
+
+/**
+ * This function sets the calibrations of the motors the odometry provided
+ * to it models.
+ */
+void odometry_set_calibration(odometry* op, motor_calibration lcal,
+                                            motor_calibration rcal);
+
+/**
+ * This function moves the pose of the odometry provided to it back to the
+ * origin.
+ */
+void odometry_reset(odometry* op);
+
+/**
+ * This function adds the movement made since the last update to the pose
+ * of the odometry provided to it, then records the duty cycles the motors
+ * run at from now on.
+ */
+void odometry_update(odometry* op, int lduty_cycle, int rduty_cycle);
+
+/**
+ * This function returns the pose of the odometry provided to it. It never
+ * waits for a lock, so it can be called from any thread.
+ */
+odometry_pose odometry_get_pose(odometry o);
+
+#endif
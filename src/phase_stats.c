@@ -0,0 +1,127 @@
+/**
+ * phase_stats.c
+ *
+ * This file contains the internal data-structure and function definitions
+ * for the phase_stats type.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#include "phase_stats.h"
+
+/**
+ * These are the names of the phases, which are the functions they time.
+ */
+char* phase_names[NUM_PHASES] = {
+    "interface_get_user_in", "interface_build_commands", "interface_update",
+    "drive_update", "rack_update", "interface_display"
+};
+
+/**
+ * This is the internal data of the phase_stats type.
+ */
+struct phase_stats_data {
+    histogram phases[NUM_PHASES];   /* How long each phase took. */
+};
+
+/**
+ * This function initialises the phase_stats provided to it.
+ */
+void phase_stats_init(phase_stats* sp)
+{
+    int p;
+
+    /* Allocate memory to the phase stats. */
+    *sp = (phase_stats) malloc(sizeof(struct phase_stats_data));
+
+    for (p = 0; p < NUM_PHASES; p++)
+        histogram_init(&(*sp)->phases[p]);
+}
+
+/**
+ * This function terminates the phase_stats provided to it.
+ */
+void phase_stats_term(phase_stats* sp)
+{
+    int p;
+
+    for (p = 0; p < NUM_PHASES; p++)
+        histogram_term(&(*sp)->phases[p]);
+
+    /* De-allocate memory from the phase stats. */
+    free(*sp);
+}
+
+/**
+ * This function records that the phase provided to it ran from start until
+ * now.
+ */
+void phase_stats_record(phase_stats* sp, enum Phase phase, uint64_t start)
+{
+    histogram_record(&(*sp)->phases[phase], monotonic_nanos() - start);
+}
+
+/**
+ * This function returns the name of the phase provided to it.
+ */
+char* phase_stats_name(enum Phase phase)
+{
+    return phase_names[phase];
+}
+
+/**
+ * This function returns a summary of how long the phase provided to it
+ * has taken.
+ */
+phase_summary phase_stats_summarise(phase_stats s, enum Phase phase)
+{
+    histogram h = s->phases[phase];     /* The phase's histogram. */
+
+    return (phase_summary) {
+        .count = histogram_get_count(h),
+        .p50 = histogram_percentile(h, 50),
+        .p99 = histogram_percentile(h, 99),
+        .max = histogram_get_max(h)
+    };
+}
+
+/**
+ * This function writes a summary of every phase, followed by all of their
+ * histograms, to the file provided to it.
+ */
+void phase_stats_dump(phase_stats s, char* fname)
+{
+    FILE* fs;           /* The file. */
+    phase_summary sum;  /* The summary of a phase. */
+    char* tstamp;       /* A time stamp. */
+    int p;
+
+    if ((fs = fopen(fname, "w")) == NULL)
+    {
+        fprintf(stderr, "[ %s ] ERROR: In function phase_stats_dump(): "
+                        "Could not create %s\n",
+                (tstamp = timestamp()), fname);
+        free(tstamp);
+        return;
+    }
+
+    /* Summarise the phases. */
+    fprintf(fs, "# phase\tcount\tp50_ns\tp99_ns\tmax_ns\n");
+    for (p = 0; p < NUM_PHASES; p++)
+    {
+        sum = phase_stats_summarise(s, p);
+        fprintf(fs, "%s\t%llu\t%llu\t%llu\t%llu\n", phase_names[p],
+                (unsigned long long) sum.count,
+                (unsigned long long) sum.p50,
+                (unsigned long long) sum.p99,
+                (unsigned long long) sum.max);
+    }
+
+    /* Write out the buckets of every phase. */
+    fprintf(fs, "\n# phase\tbucket_top_ns\tcount\tpercentile\n");
+    for (p = 0; p < NUM_PHASES; p++)
+        histogram_print(s->phases[p], phase_names[p], fs);
+
+    fclose(fs);
+}
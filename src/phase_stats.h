@@ -0,0 +1,89 @@
+/**
+ * phase_stats.h
+ *
+ * This file contains the public data-structure and function prototype
+ * declarations for the phase_stats type, as well as enumeration
+ * definitions for it.
+ *
+ * The phase_stats type keeps a histogram of how long each phase of the
+ * rover's frames takes, so a slow frame can be put down to the input, the
+ * drive, the rack or the drawing of the interface.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#ifndef phase_stats_h
+#define phase_stats_h
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "histogram.h"
+#include "mycutils.h"
+
+/**
+ * These are the phases of a frame.
+ */
+enum Phase {
+    GET_USER_IN_PHASE,      /* Taking the user's command. */
+    BUILD_COMMANDS_PHASE,   /* Building the frame's commands. */
+    INTERFACE_UPDATE_PHASE, /* Updating the interface. */
+    DRIVE_UPDATE_PHASE,     /* Updating the drive. */
+    RACK_UPDATE_PHASE,      /* Updating the rack. */
+    DISPLAY_PHASE,          /* Drawing the interface. */
+    NUM_PHASES
+};
+
+/**
+ * This is a summary of how long a phase has taken, in nano-seconds.
+ */
+typedef struct {
+    uint64_t count; /* The times the phase has run. */
+    uint64_t p50;   /* The time half of them took at most. */
+    uint64_t p99;   /* The time 99 in every 100 took at most. */
+    uint64_t max;   /* The longest it took. */
+} phase_summary;
+
+/**
+ * This is the data-structure of the phase_stats type.
+ */
+typedef struct phase_stats_data* phase_stats;
+
+/**
+ * This function initialises the phase_stats provided to it.
+ */
+void phase_stats_init(phase_stats* sp);
+
+/**
+ * This function terminates the phase_stats provided to it.
+ */
+void phase_stats_term(phase_stats* sp);
+
+/**
+ * This function records that the phase provided to it ran from start, a
+ * time returned by monotonic_nanos(), until now. Each phase may only be
+ * recorded by one thread at a time.
+ */
+void phase_stats_record(phase_stats* sp, enum Phase phase, uint64_t start);
+
+/**
+ * This function returns the name of the phase provided to it.
+ */
+char* phase_stats_name(enum Phase phase);
+
+/**
+ * This function returns a summary of how long the phase provided to it
+ * has taken.
+ */
+phase_summary phase_stats_summarise(phase_stats s, enum Phase phase);
+
+/**
+ * This function writes a summary of every phase, followed by all of their
+ * histograms, to the file provided to it.
+ */
+void phase_stats_dump(phase_stats s, char* fname);
+
+#endif
@@ -0,0 +1,427 @@
+/**
+ * pwm_engine.c
+ *
+ * This file contains the internal data-structure and function definitions
+ * for the pwm_engine type.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#include "pwm_engine.h"
+
+/**
+ * This is one of the engine's channels.
+ */
+typedef struct {
+    int pin;            /* The gpio pin the channel drives. */
+    int duty_cycle;     /* The duty cycle of the channel, as a percentage. */
+    int hw_channel;     /* The hardware pwm channel, or -1 for software. */
+} pwm_channel;
+
+/**
+ * This is a point in a period where some of the software channels' pins
+ * go low.
+ */
+typedef struct {
+    uint64_t offset;                    /* Nanoseconds into the period. */
+    int num_pins;                       /* The number of pins going low. */
+    int pins[PWM_ENGINE_MAX_CHANNELS];  /* The pins going low. */
+} pwm_edge;
+
+/**
+ * This is the order the software channels' pins change in during a period.
+ */
+typedef struct {
+    int num_high;                       /* The number of pins going high. */
+    int high[PWM_ENGINE_MAX_CHANNELS];  /* The pins going high. */
+    int num_edges;                      /* The number of falling edges. */
+    pwm_edge edges[PWM_ENGINE_MAX_CHANNELS];
+} pwm_schedule;
+
+/**
+ * This is the internal data-structure of the pwm_engine type.
+ */
+struct pwm_engine_data {
+    uint64_t period;        /* The length of a period, in nanoseconds. */
+    int num_channels;       /* The number of channels. */
+    pwm_channel channels[PWM_ENGINE_MAX_CHANNELS];
+
+    /* This is the schedule the timing thread follows. It is only rebuilt
+     * when a software channel's duty cycle changes. */
+    pwm_schedule schedule;
+
+    /* This is whether the schedule has changed since the timing thread
+     * last copied it. */
+    bool schedule_changed;
+
+    pthread_t thread;       /* The timing thread. */
+    pthread_mutex_t lock;   /* Guards everything the timing thread reads. */
+    pthread_cond_t wake;    /* Wakes the timing thread when it's idle. */
+    bool running;           /* Whether the timing thread should keep going. */
+    uint64_t wakeups;       /* The number of times the thread has woken. */
+};
+
+/**
+ * This function prints an error message about the pwm engine function named
+ * fname and exits the program.
+ */
+void pwm_engine_error(char* fname, char* msg)
+{
+    char* tstamp;   /* A time stamp. */
+
+    /* Print an error message. */
+    fprintf(stderr,
+            "[ %s ] ERROR: In function %s(): %s\n",
+            (tstamp = timestamp()), fname, msg);
+
+    /* De-allocate memory. */
+    free(tstamp);
+
+    /* Exit the program. */
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * This function writes the value provided to it to the sysfs file in the
+ * hardware pwm chip's directory named by fmt. It returns whether the write
+ * worked.
+ */
+bool sysfs_write(char* value, char* fmt, int hw_channel)
+{
+    char path[128]; /* The path of the file. */
+    FILE* fp;       /* The file. */
+    bool ok;        /* Whether the write worked. */
+
+    snprintf(path, sizeof(path), fmt, hw_channel);
+    if ((fp = fopen(path, "w")) == NULL)
+        return false;
+    ok = fputs(value, fp) >= 0;
+    ok = (fclose(fp) == 0) && ok;
+    return ok;
+}
+
+/**
+ * This function sets the duty cycle of a hardware pwm channel.
+ */
+void hw_set_duty_cycle(pwm_engine* pp, int hw_channel, int duty_cycle)
+{
+    char value[32]; /* The duty cycle in nanoseconds. */
+
+    snprintf(value, sizeof(value), "%llu",
+             (unsigned long long) ((*pp)->period * duty_cycle / 100));
+    sysfs_write(value, PWM_ENGINE_SYSFS_CHIP "/pwm%d/duty_cycle", hw_channel);
+}
+
+/**
+ * This function tries to give the hardware pwm channel provided to it a
+ * period and start it. It returns whether that worked.
+ */
+bool hw_start(pwm_engine* pp, int hw_channel)
+{
+    char value[32]; /* The period in nanoseconds. */
+    char export[8]; /* The channel's number. */
+
+    /* Make the channel's directory appear. It may already be there. */
+    snprintf(export, sizeof(export), "%d", hw_channel);
+    sysfs_write(export, PWM_ENGINE_SYSFS_CHIP "/export", 0);
+
+    /* Start the channel at a zero duty cycle. */
+    snprintf(value, sizeof(value), "%llu", (unsigned long long) (*pp)->period);
+    return sysfs_write("0", PWM_ENGINE_SYSFS_CHIP "/pwm%d/duty_cycle", hw_channel)
+        && sysfs_write(value, PWM_ENGINE_SYSFS_CHIP "/pwm%d/period", hw_channel)
+        && sysfs_write("1", PWM_ENGINE_SYSFS_CHIP "/pwm%d/enable", hw_channel);
+}
+
+/**
+ * This function stops the hardware pwm channel provided to it.
+ */
+void hw_stop(int hw_channel)
+{
+    char export[8]; /* The channel's number. */
+
+    sysfs_write("0", PWM_ENGINE_SYSFS_CHIP "/pwm%d/enable", hw_channel);
+    snprintf(export, sizeof(export), "%d", hw_channel);
+    sysfs_write(export, PWM_ENGINE_SYSFS_CHIP "/unexport", 0);
+}
+
+/**
+ * This function rebuilds the schedule of the pwm engine provided to it from
+ * its software channels' duty cycles. The engine must be locked.
+ */
+void build_schedule(pwm_engine* pp)
+{
+    pwm_schedule* s;    /* The schedule being built. */
+    pwm_channel* c;     /* The channel being added. */
+    uint64_t offset;    /* When the channel's pin goes low. */
+    int e;              /* The edge the pin goes low on. */
+    int c_num;
+
+    s = &(*pp)->schedule;
+    s->num_high = 0;
+    s->num_edges = 0;
+    for (c_num = 0; c_num < (*pp)->num_channels; c_num++)
+    {
+        c = &(*pp)->channels[c_num];
+
+        /* Hardware channels and pins that stay low aren't scheduled. */
+        if (c->hw_channel >= 0 || c->duty_cycle <= 0)
+            continue;
+        s->high[s->num_high++] = c->pin;
+
+        /* Pins that stay high never go low. */
+        if (c->duty_cycle >= 100)
+            continue;
+
+        /* Insert the pin's falling edge so the edges stay in order,
+         * sharing an edge with any pin that goes low at the same time. */
+        offset = (*pp)->period * c->duty_cycle / 100;
+        for (e = 0; e < s->num_edges && s->edges[e].offset < offset; e++)
+            NULL;
+        if (e == s->num_edges || s->edges[e].offset != offset)
+        {
+            memmove(&s->edges[e + 1], &s->edges[e],
+                    sizeof(pwm_edge) * (s->num_edges - e));
+            s->edges[e].offset = offset;
+            s->edges[e].num_pins = 0;
+            s->num_edges++;
+        }
+        s->edges[e].pins[s->edges[e].num_pins++] = c->pin;
+    }
+    (*pp)->schedule_changed = true;
+}
+
+/**
+ * This function adds the nanoseconds provided to it to the time provided to
+ * it.
+ */
+void add_nanos(struct timespec* ts, uint64_t nanos)
+{
+    nanos += ts->tv_nsec;
+    ts->tv_sec += nanos / NANOS_PER_SEC;
+    ts->tv_nsec = nanos % NANOS_PER_SEC;
+}
+
+/**
+ * This function is run by the timing thread of the pwm engine provided to
+ * it. Each period it raises every scheduled pin, then sleeps until each
+ * falling edge in turn, so it only wakes once per distinct edge however
+ * many channels there are.
+ */
+void* pwm_engine_run(void* arg)
+{
+    pwm_engine p;           /* The engine being run. */
+    pwm_schedule s;         /* The timing thread's copy of the schedule. */
+    struct timespec start;  /* The start of the current period. */
+    struct timespec edge;   /* The time of the next edge. */
+    bool pins_high;         /* Whether the pins were raised last period. */
+    int e;
+    int pin;
+
+    p = (pwm_engine) arg;
+    s.num_high = 0;
+    s.num_edges = 0;
+    pins_high = false;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    pthread_mutex_lock(&p->lock);
+    while (p->running)
+    {
+        /* Pick up the new schedule. */
+        if (p->schedule_changed)
+        {
+            /* Lower the pins that were high under the old schedule. */
+            for (pin = 0; pin < s.num_high; pin++)
+                gpio_output(s.high[pin], LOW);
+            s = p->schedule;
+            p->schedule_changed = false;
+            pins_high = false;
+        }
+
+        /* Sleep until something changes if no pin needs to toggle. */
+        if (s.num_edges == 0)
+        {
+            /* Pins that stay high only need raising once. */
+            if (!pins_high)
+                for (pin = 0; pin < s.num_high; pin++)
+                    gpio_output(s.high[pin], HIGH);
+            pins_high = true;
+            pthread_cond_wait(&p->wake, &p->lock);
+            p->wakeups++;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            continue;
+        }
+        pthread_mutex_unlock(&p->lock);
+
+        /* Start the period. */
+        for (pin = 0; pin < s.num_high; pin++)
+            gpio_output(s.high[pin], HIGH);
+
+        /* Lower the pins at each edge. */
+        for (e = 0; e < s.num_edges; e++)
+        {
+            edge = start;
+            add_nanos(&edge, s.edges[e].offset);
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &edge, NULL);
+            for (pin = 0; pin < s.edges[e].num_pins; pin++)
+                gpio_output(s.edges[e].pins[pin], LOW);
+        }
+
+        /* Wait for the next period. */
+        add_nanos(&start, p->period);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &start, NULL);
+
+        pthread_mutex_lock(&p->lock);
+        p->wakeups += s.num_edges + 1;
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    /* Leave every pin low. */
+    for (pin = 0; pin < s.num_high; pin++)
+        gpio_output(s.high[pin], LOW);
+
+    return NULL;
+}
+
+/**
+ * This function initialises the pwm engine provided to it. Every channel
+ * of the engine runs at the frequency provided to this function.
+ */
+void pwm_engine_init(pwm_engine* pp, int frequency)
+{
+    /* Allocate memory to the engine. */
+    *pp = (pwm_engine) malloc(sizeof(struct pwm_engine_data));
+
+    /* Initialise properties. */
+    (*pp)->period = NANOS_PER_SEC / frequency;
+    (*pp)->num_channels = 0;
+    (*pp)->running = true;
+    (*pp)->wakeups = 0;
+    pthread_mutex_init(&(*pp)->lock, NULL);
+    pthread_cond_init(&(*pp)->wake, NULL);
+    build_schedule(pp);
+
+    /* Start the timing thread. */
+    if (pthread_create(&(*pp)->thread, NULL, pwm_engine_run, *pp) != 0)
+        pwm_engine_error("pwm_engine_init",
+                         "Could not start the timing thread");
+}
+
+/**
+ * This function terminates the pwm engine provided to it. It leaves every
+ * channel's pin low.
+ */
+void pwm_engine_term(pwm_engine* pp)
+{
+    int c;
+
+    /* Stop the timing thread. */
+    pthread_mutex_lock(&(*pp)->lock);
+    (*pp)->running = false;
+    pthread_cond_signal(&(*pp)->wake);
+    pthread_mutex_unlock(&(*pp)->lock);
+    pthread_join((*pp)->thread, NULL);
+
+    /* Stop the hardware channels. */
+    for (c = 0; c < (*pp)->num_channels; c++)
+        if ((*pp)->channels[c].hw_channel >= 0)
+            hw_stop((*pp)->channels[c].hw_channel);
+
+    /* De-allocate memory from the engine. */
+    pthread_mutex_destroy(&(*pp)->lock);
+    pthread_cond_destroy(&(*pp)->wake);
+    free(*pp);
+}
+
+/**
+ * This function adds a channel driving the gpio pin provided to it to the
+ * pwm engine provided to it, and returns the channel's number. The channel
+ * uses hardware pwm if the pin has it, otherwise it is generated by the
+ * engine's timing thread. The pin must already be set up as an output.
+ */
+int pwm_engine_add_channel(pwm_engine* pp, int pin)
+{
+    pwm_channel* c;     /* The new channel. */
+    int c_num;          /* The new channel's number. */
+
+    /* Make sure there is room for the channel. */
+    if ((*pp)->num_channels == PWM_ENGINE_MAX_CHANNELS)
+        pwm_engine_error("pwm_engine_add_channel", "Too many channels");
+
+    pthread_mutex_lock(&(*pp)->lock);
+    c_num = (*pp)->num_channels++;
+    c = &(*pp)->channels[c_num];
+    c->pin = pin;
+    c->duty_cycle = 0;
+
+    /* Pins 12 and 13 are wired to the two hardware pwm channels. Fall back
+     * to software if the hardware channel can't be started, or if the pins
+     * aren't real. */
+    c->hw_channel = -1;
+    if ((pin == 12 || pin == 13) && gpio_has_hardware_pwm())
+        if (hw_start(pp, pin - 12))
+            c->hw_channel = pin - 12;
+    pthread_mutex_unlock(&(*pp)->lock);
+
+    return c_num;
+}
+
+/**
+ * This function returns whether the channel provided to it uses hardware
+ * pwm.
+ */
+bool pwm_engine_is_hardware(pwm_engine p, int channel)
+{
+    return p->channels[channel].hw_channel >= 0;
+}
+
+/**
+ * This function sets the duty cycle, as a percentage, of a channel of the
+ * pwm engine provided to it.
+ */
+void pwm_engine_set_duty_cycle(pwm_engine* pp, int channel, int duty_cycle)
+{
+    pwm_channel* c; /* The channel. */
+
+    /* Keep the duty cycle between 0 and 100 percent. */
+    if (duty_cycle < 0)
+        duty_cycle = 0;
+    else if (duty_cycle > 100)
+        duty_cycle = 100;
+
+    pthread_mutex_lock(&(*pp)->lock);
+    c = &(*pp)->channels[channel];
+
+    /* Only do work if the duty cycle has changed. */
+    if (c->duty_cycle != duty_cycle)
+    {
+        c->duty_cycle = duty_cycle;
+
+        /* Hardware channels just need telling. */
+        if (c->hw_channel >= 0)
+            hw_set_duty_cycle(pp, c->hw_channel, duty_cycle);
+
+        /* Software channels need a new schedule. */
+        else
+        {
+            build_schedule(pp);
+            pthread_cond_signal(&(*pp)->wake);
+        }
+    }
+    pthread_mutex_unlock(&(*pp)->lock);
+}
+
+/**
+ * This function returns the number of times the timing thread of the pwm
+ * engine provided to it has woken up.
+ */
+uint64_t pwm_engine_get_wakeups(pwm_engine p)
+{
+    uint64_t wakeups;   /* The number of wakeups. */
+
+    pthread_mutex_lock(&p->lock);
+    wakeups = p->wakeups;
+    pthread_mutex_unlock(&p->lock);
+
+    return wakeups;
+}
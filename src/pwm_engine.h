@@ -0,0 +1,77 @@
+/*
+ * pwm_engine.h
+ *
+ * This file contains the public data-structure and public function prototype
+ * declarations for the pwm_engine type.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#ifndef pwm_engine_h
+#define pwm_engine_h
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "gpio.h"
+#include "mycutils.h"
+
+/* This is the most channels a pwm engine can drive. */
+#define PWM_ENGINE_MAX_CHANNELS 8
+
+/* This is the directory the kernel's hardware pwm chip is found in. It
+ * drives pin 12 on channel 0 and pin 13 on channel 1 once the pwm-2chan
+ * overlay has given those pins to it. */
+#define PWM_ENGINE_SYSFS_CHIP "/sys/class/pwm/pwmchip0"
+
+/**
+ * This is the data-structure of the pwm_engine type.
+ */
+typedef struct pwm_engine_data* pwm_engine;
+
+/**
+ * This function initialises the pwm engine provided to it. Every channel
+ * of the engine runs at the frequency provided to this function.
+ */
+void pwm_engine_init(pwm_engine* pp, int frequency);
+
+/**
+ * This function terminates the pwm engine provided to it. It leaves every
+ * channel's pin low.
+ */
+void pwm_engine_term(pwm_engine* pp);
+
+/**
+ * This function adds a channel driving the gpio pin provided to it to the
+ * pwm engine provided to it, and returns the channel's number. The channel
+ * uses hardware pwm if the pin has it, otherwise it is generated by the
+ * engine's timing thread. The pin must already be set up as an output.
+ */
+int pwm_engine_add_channel(pwm_engine* pp, int pin);
+
+/**
+ * This function returns whether the channel provided to it uses hardware
+ * pwm.
+ */
+bool pwm_engine_is_hardware(pwm_engine p, int channel);
+
+/**
+ * This function sets the duty cycle, as a percentage, of a channel of the
+ * pwm engine provided to it.
+ */
+void pwm_engine_set_duty_cycle(pwm_engine* pp, int channel, int duty_cycle);
+
+/**
+ * This function returns the number of times the timing thread of the pwm
+ * engine provided to it has woken up.
+ */
+uint64_t pwm_engine_get_wakeups(pwm_engine p);
+
+#endif
@@ -19,6 +19,50 @@ typedef struct {
     bool visited;
 } position;
 
+/**
+ * This is the data-structure of the cached result of a light search.
+ */
+typedef struct {
+    bool valid;             /* Whether there is a result. */
+    position best;          /* The brightest position that was found. */
+    ldr_reading reading;    /* The reading made at the brightest position. */
+    struct timespec time;   /* The time the search finished. */
+    int falls;              /* How many readings in a row since have said
+                             * the light has fallen. */
+    bool checking;          /* Whether a reading is being made to check
+                             * the result. */
+} search_cache;
+
+/**
+ * This is the data-structure of a light search that is running.
+ */
+typedef struct {
+    task t;                     /* Runs the search a little at a time. */
+    enum SearchStage stage;     /* What the search is doing. */
+    position current;           /* The position being visited. */
+    position next;              /* The position to visit after it. */
+    position brightest;         /* The brightest position so far. */
+    position predicted;         /* The position the light map predicted
+                                 * is the brightest. */
+    bool has_prediction;        /* Whether the light map predicted one. */
+    ldr_reading best_reading;   /* The reading at the brightest position. */
+    light_sample* samples;      /* The readings made at every position. */
+    int visited;                /* The number of positions visited. */
+    int total;                  /* The number of positions to visit. */
+    double confidence;          /* How confident an early stop would be. */
+    time_t now;                 /* The time the search started. */
+} light_search_task;
+
+/**
+ * This is the data-structure of the automatic tracking of the light.
+ */
+typedef struct {
+    task t;                         /* Runs the tracking a little at a
+                                     * time. */
+    bool enabled;                   /* Whether the light is tracked. */
+    bool sampling;                  /* Whether a sample is being made. */
+} tracker;
+
 /**
  * This is the internal data-structure of the Rack type.
  */
@@ -42,6 +86,17 @@ struct rack_data {
     /* This is the amount of positions the rack can be in. */
     int num_positions;
 
+    /* These are the number of columns and rows of the search grid. */
+    int num_x;
+    int num_z;
+
+    /* This is the rate, in steps per second, the rack's motors normally
+     * rotate at. */
+    unsigned int step_rate;
+
+    /* This is the time, in nano-seconds, between updates of the rack. */
+    uint64_t frame_time;
+
     /* This is the maximum angle the x axis can rotate to. */
     int max_x;
 
@@ -54,6 +109,46 @@ struct rack_data {
     /* This is the current angle of the z axis. */
     int cur_z;
 
+    /* This is the current step position of the x axis. */
+    long x_steps;
+
+    /* This is the current step position of the z axis. */
+    long z_steps;
+
+    /* This is how many steps the z axis was from where it was thought to
+     * be when the limit switch was last latched while homing. */
+    long z_home_error;
+
+    /* This journals the position of the rack to disk. */
+    journal j;
+
+    /* This is the result of the last light search. */
+    search_cache cache;
+
+    /* This remembers the readings of every light search. */
+    light_map map;
+
+    /* This is the way the rack searches for light. */
+    enum SearchMode search_mode;
+
+    /* This is how confident an early stopping search must be to stop. */
+    double search_confidence;
+
+    /* This is the number of moves the last search skipped. */
+    int skipped_moves;
+
+    /* This is the number of steps the last search skipped. */
+    long skipped_steps;
+
+    /* This homes the z axis a little at a time. */
+    task homing;
+
+    /* This is the light search that is running, if any. */
+    light_search_task search;
+
+    /* This keeps the rack pointed at the light without an operator. */
+    tracker tracking;
+
 };
 
 /**
@@ -85,25 +180,49 @@ int get_degree_of_rotation(char* fname)
 }
 
 /**
- * This function writes the degree of rotation of the axis corresponding to
- * the file past to the funciton.
+ * This function converts an angle in degrees to an absolute step position
+ * using the fixed-point number of steps per degree provided to it. The
+ * result is rounded to the nearest step so that the fraction left over by
+ * one degree is carried into the next instead of being lost.
  */
-void store_degree_of_rotation(char* fname, int degree)
+long degrees_to_steps(int degrees, int64_t steps_per_degree)
 {
-    /* This is the file stream. */
-    FILE* fs;
+    int64_t scaled = (int64_t) degrees * steps_per_degree;
 
-    /* This stores the degree value as a string. */
-    char* buf;
-    
-    /* Convert the degree to a string and write it to the file. */
-    strfmt(&buf, "%d", degree);
-    fs = openfs(fname, "w");
-    writefss(fs, buf);
+    /* Round half away from zero. */
+    if (scaled < 0)
+        return -((-scaled + (STEPS_ONE >> 1)) >> STEPS_FRAC_BITS);
+    return (scaled + (STEPS_ONE >> 1)) >> STEPS_FRAC_BITS;
+}
 
-    /* Close the file and de-allocate memory. */
-    closefs(fs);
-    free(buf);
+/**
+ * This function converts an absolute step position to the nearest angle
+ * in degrees using the fixed-point number of steps per degree provided
+ * to it.
+ */
+int steps_to_degrees(long steps, int64_t steps_per_degree)
+{
+    int64_t scaled = (int64_t) steps << STEPS_FRAC_BITS;
+
+    /* Round half away from zero. */
+    if (scaled < 0)
+        return -((-scaled + steps_per_degree / 2) / steps_per_degree);
+    return (scaled + steps_per_degree / 2) / steps_per_degree;
+}
+
+/**
+ * This function stages the position of the rack to be written to its
+ * journal, and writes it if enough time has passed since the last write.
+ */
+void store_position(rack* rp)
+{
+    journal_update(&(*rp)->j, (journal_state) {
+        .cur_x = (*rp)->cur_x,
+        .cur_z = (*rp)->cur_z,
+        .x_steps = (*rp)->x_steps,
+        .z_steps = (*rp)->z_steps
+    });
+    journal_sync(&(*rp)->j);
 }
 
 /**
@@ -111,65 +230,119 @@ void store_degree_of_rotation(char* fname, int degree)
  */
 void rack_init(rack* rp)
 {
-    int p, x, z;
+    rack_init_files(rp, RACK_JOURNAL, RACK_LIGHT_MAP);
+}
+
+/**
+ * This function initialises the rack provided to it, journaling its
+ * position to journal_file and storing the readings of its light searches
+ * in light_map_file.
+ */
+void rack_init_files(rack* rp, char* journal_file, char* light_map_file)
+{
+    journal_state state;
 
     /* Allocate memory to the rack. */
     *rp = (rack) malloc(sizeof(struct rack_data));
 
     /* Initialise motors. */
-    stepper_motor_init(&(*rp)->zmotor, 2048, 26, 20, 19, 16);
-    stepper_motor_steps_per_sec(&(*rp)->zmotor, 400);
-    stepper_motor_init(&(*rp)->xmotor, 2048, 22, 10, 24, 9);
-    stepper_motor_steps_per_sec(&(*rp)->xmotor, 400);
+    stepper_motor_init(&(*rp)->zmotor, 2048, RACK_ZMOTOR_PINS);
+    stepper_motor_init(&(*rp)->xmotor, 2048, RACK_XMOTOR_PINS);
+    rack_set_step_rate(rp, RACK_STEPS_PER_SEC);
+    rack_set_frame_time(rp, RACK_FRAME_TIME);
 
     /* Initialise light the light dependant resistor. */
-    ldr_init(&(*rp)->l, 14, 15, 18);
+    ldr_init(&(*rp)->l, RACK_LDR_PINS);
 
     /* Initialise the limit switch. */
-    button_init(&(*rp)->limit_switch, 1, 2);
+    button_init(&(*rp)->limit_switch, RACK_LIMIT_SWITCH_PIN, 2);
     button_set_debounce_time(&(*rp)->limit_switch, 50000000);
 
     /* Initialise the maximum degress of rotation. */
     (*rp)->max_x = 25;
     (*rp)->max_z = 90;
+    (*rp)->z_home_error = 0;
+    (*rp)->cache.valid = false;
+    (*rp)->cache.falls = 0;
+    (*rp)->cache.checking = false;
+
+    /* Load the readings of past light searches. */
+    light_map_init(&(*rp)->map, light_map_file);
+
+    /* Initialise the way the rack searches for light. */
+    (*rp)->search_mode = FULL_SEARCH;
+    (*rp)->search_confidence = SEARCH_CONFIDENCE;
+    (*rp)->skipped_moves = 0;
+    (*rp)->skipped_steps = 0;
+    TASK_RESET(&(*rp)->homing);
+    (*rp)->search.stage = SEARCH_IDLE;
+    TASK_RESET(&(*rp)->search.t);
+    (*rp)->tracking.enabled = false;
+    (*rp)->tracking.sampling = false;
+    TASK_RESET(&(*rp)->tracking.t);
+
+    /* Recover the position of the rack from its journal. */
+    journal_init(&(*rp)->j, journal_file, RACK_JOURNAL_INTERVAL);
+    if (journal_recover((*rp)->j, &state))
+    {
+        /* The step positions are exact, so the angles come from them. */
+        (*rp)->x_steps = state.x_steps;
+        (*rp)->z_steps = state.z_steps;
+        (*rp)->cur_x = steps_to_degrees((*rp)->x_steps, STEPS_PER_DEGREE_X);
+        (*rp)->cur_z = steps_to_degrees((*rp)->z_steps, STEPS_PER_DEGREE_Z);
+    }
+    else
+    {
+        /* There is no journal yet so use the files it replaces. */
+        (*rp)->cur_x = get_degree_of_rotation("../../cur_x.txt");
+        (*rp)->cur_z = get_degree_of_rotation("../../cur_z.txt");
+        (*rp)->x_steps = degrees_to_steps((*rp)->cur_x, STEPS_PER_DEGREE_X);
+        (*rp)->z_steps = degrees_to_steps((*rp)->cur_z, STEPS_PER_DEGREE_Z);
+        store_position(rp);
+        journal_flush(&(*rp)->j);
+    }
 
-    /* Initialise the current angle of the x axis. */
-    (*rp)->cur_x = get_degree_of_rotation("../../cur_x.txt");
+    /* Set up the positions a light search visits. */
+    (*rp)->positions = NULL;
+    (*rp)->search.samples = NULL;
+    rack_set_search_grid(rp, 3, 3, EDGES_LAYOUT);
+}
 
-    /* Initialise the current angle of the z axis. */
-    (*rp)->cur_z = get_degree_of_rotation("../../cur_z.txt");
+/**
+ * Forward declaration.
+ *
+ * This function cancels the light search of the rack provided to it,
+ * leaving the rack where it is.
+ */
+void light_search_cancel(rack* rp);
 
-    /* Allocate memory to the array of positions. */
-    (*rp)->num_positions = 7;
-    (*rp)->positions = 
-        (position*) malloc(sizeof(position) * (*rp)->num_positions);
+/**
+ * Forward declaration.
+ *
+ * This function abandons any sample the tracking of the rack provided to
+ * it is making, so the light dependant resistor can be used for something
+ * else.
+ */
+void tracking_abort_sample(rack* rp);
 
-    /* Initialise the positions. */
-    p = 0;
-    for (x = -(*rp)->max_x; x <= (*rp)->max_x; x += (*rp)->max_x)
-    {
-        for (z = -(*rp)->max_z; z <= (*rp)->max_z; z += (*rp)->max_z)
-        {
-            if (x == 0 && z != 0)
-            {
-                /* Don't use these positions. */
-            }
-            else
-            {
-                (*rp)->positions[p].x = x;
-                (*rp)->positions[p].z = z;
-                (*rp)->positions[p].visited = false;
-                p++;
-            }
-        }
-    }
-}
+/**
+ * Forward declaration.
+ *
+ * This function abandons any reading being made to check the result of the
+ * last light search of the rack provided to it.
+ */
+void search_cache_abort_check(rack* rp);
 
 /**
  * This function terminates the rack provided to it.
  */
 void rack_term(rack* rp)
 {
+    /* Stop any light search, check or tracking sample that is running. */
+    light_search_cancel(rp);
+    search_cache_abort_check(rp);
+    tracking_abort_sample(rp);
+
     /* Terminate the stepper_motors. */
     stepper_motor_term(&(*rp)->zmotor);
     stepper_motor_term(&(*rp)->xmotor);
@@ -180,16 +353,179 @@ void rack_term(rack* rp)
     /* Terminate the limit switch. */
     button_term(&(*rp)->limit_switch);
 
+    /* Write the position of the rack and terminate its journal. */
+    journal_term(&(*rp)->j);
+
+    /* Terminate the light map. */
+    light_map_term(&(*rp)->map);
+
     /* De-allocate memory from the rack. */
+    free((*rp)->search.samples);
+    free((*rp)->positions);
     free(*rp);
 }
 
 /**
- * Forward declaration.
- *
- * This function uses a limit switch to rotate the z axis to -90 degrees.
+ * This function returns the most steps an axis of the rack provided to it
+ * takes in one update while stepping at the rate provided to it, which is
+ * RACK_TICK_PERCENT of an update's worth.
  */
-void reset_z(rack* rp);
+long steps_per_tick(rack* rp, unsigned int steps_per_sec)
+{
+    long steps = (long) ((*rp)->frame_time * steps_per_sec / NANOS_PER_SEC
+                         * RACK_TICK_PERCENT / 100);
+
+    return steps > 0 ? steps : 1;
+}
+
+/**
+ * This function returns true if the limit switch provided to it is pressed.
+ */
+bool limit_switch_hit(void* limit_switch)
+{
+    return button_get_state_raw((button) limit_switch) == LOW;
+}
+
+/**
+ * This function homes the z axis of the rack provided to it against its
+ * limit switch, a little more every time it is called so that homing can
+ * be spread over several updates. It returns TASK_DONE once the z axis is
+ * at -90 degrees.
+ */
+enum TaskStatus home_z_task(rack* rp)
+{
+    /* This is the homing task. */
+    task* t = &(*rp)->homing;
+
+    /* This is the step position of the z axis at -90 degrees. */
+    long home = degrees_to_steps(-(*rp)->max_z, STEPS_PER_DEGREE_Z);
+
+    /* This is the furthest past home the z axis will look for its limit
+     * switch. */
+    long limit = home - degrees_to_steps(10, STEPS_PER_DEGREE_Z);
+
+    /* This is the number of steps to take. */
+    long steps;
+
+    TASK_BEGIN(t);
+
+    /* Approach quickly until just short of where the limit switch should
+     * be, checking it before every step in case the z axis is further
+     * round than it was thought to be. */
+    stepper_motor_steps_per_sec(&(*rp)->zmotor, Z_HOMING_FAST_RATE);
+    while (!limit_switch_hit((*rp)->limit_switch)
+           && (steps = (*rp)->z_steps - (home + Z_HOMING_BACKOFF)) > 0)
+    {
+        if (steps > steps_per_tick(rp, Z_HOMING_FAST_RATE))
+            steps = steps_per_tick(rp, Z_HOMING_FAST_RATE);
+        (*rp)->z_steps += stepper_motor_step_until(&(*rp)->zmotor, -steps,
+                                                   limit_switch_hit,
+                                                   (*rp)->limit_switch);
+        if (estop_is_halted())
+        {
+            stepper_motor_steps_per_sec(&(*rp)->zmotor, (*rp)->step_rate);
+            TASK_RESTART(t);
+        }
+        TASK_YIELD(t);
+    }
+
+    /* If the switch was already pressed, back away from it so the slow
+     * approach finds where it triggers. */
+    if (limit_switch_hit((*rp)->limit_switch))
+    {
+        (*rp)->z_steps += stepper_motor_step(&(*rp)->zmotor,
+                                             Z_HOMING_BACKOFF);
+        TASK_YIELD(t);
+    }
+
+    /* Approach the switch slowly, checking it before every step, and latch
+     * where it triggered. */
+    stepper_motor_steps_per_sec(&(*rp)->zmotor, Z_HOMING_SLOW_RATE);
+    while (!limit_switch_hit((*rp)->limit_switch)
+           && (steps = (*rp)->z_steps - limit) > 0)
+    {
+        if (steps > steps_per_tick(rp, Z_HOMING_SLOW_RATE))
+            steps = steps_per_tick(rp, Z_HOMING_SLOW_RATE);
+        (*rp)->z_steps += stepper_motor_step_until(&(*rp)->zmotor, -steps,
+                                                   limit_switch_hit,
+                                                   (*rp)->limit_switch);
+        if (estop_is_halted())
+        {
+            stepper_motor_steps_per_sec(&(*rp)->zmotor, (*rp)->step_rate);
+            TASK_RESTART(t);
+        }
+        TASK_YIELD(t);
+    }
+    stepper_motor_steps_per_sec(&(*rp)->zmotor, (*rp)->step_rate);
+
+    /* The switch triggers at -90 degrees, so the latched position is how
+     * far the z axis was from where it was thought to be. If the switch
+     * never triggered, the axis is as far as it is allowed to go and is
+     * taken to be home. */
+    if (!limit_switch_hit((*rp)->limit_switch))
+        LOG_WARN("z_home_missed", LOG_INT("z_steps", (*rp)->z_steps));
+    (*rp)->z_home_error = (*rp)->z_steps - home;
+    (*rp)->z_steps -= (*rp)->z_home_error;
+    (*rp)->cur_z = -(*rp)->max_z;
+    
+    /* Journal the z axis' position. */
+    store_position(rp);
+
+    TASK_END(t);
+}
+
+/**
+ * This function uses a limit switch to rotate the z axis to -90 degrees,
+ * running the homing task until it is done. It blocks, so it is only used
+ * when a move finds the limit switch early and the z axis has to be found
+ * again before anything else can happen.
+ */
+void reset_z(rack* rp)
+{
+    while (!estop_is_halted() && home_z_task(rp) != TASK_DONE);
+}
+
+/**
+ * This function steps the axis corresponding to the char passed to the
+ * function to the absolute step position that is also passed to it. The
+ * angle of the axis is then worked out from its step position.
+ */
+void step_axis(rack* rp, char axis, long target)
+{
+    /* This is the number of steps that were taken. */
+    int taken;
+
+    if (axis == 'x')
+    {
+        /* Step the x axis. */
+        (*rp)->x_steps += stepper_motor_step(&(*rp)->xmotor,
+                                             target - (*rp)->x_steps);
+        (*rp)->cur_x = steps_to_degrees((*rp)->x_steps, STEPS_PER_DEGREE_X);
+    }
+    else if (target >= (*rp)->z_steps)
+    {
+        /* Step the z axis away from its limit switch. */
+        (*rp)->z_steps += stepper_motor_step(&(*rp)->zmotor,
+                                             target - (*rp)->z_steps);
+        (*rp)->cur_z = steps_to_degrees((*rp)->z_steps, STEPS_PER_DEGREE_Z);
+    }
+    else
+    {
+        /* Step the z axis towards its limit switch, watching it on every
+         * step. */
+        taken = stepper_motor_step_until(&(*rp)->zmotor,
+                                         target - (*rp)->z_steps,
+                                         limit_switch_hit,
+                                         (*rp)->limit_switch);
+        (*rp)->z_steps += taken;
+        (*rp)->cur_z = steps_to_degrees((*rp)->z_steps, STEPS_PER_DEGREE_Z);
+
+        /* The rack reached its maximum anti-clockwise rotation early, so
+         * it wasn't where it was thought to be. */
+        if ((*rp)->z_steps != target && !estop_is_halted())
+            reset_z(rp);
+    }
+}
 
 /**
  * This function rotates the rack provided to it by one degree on its z axis.
@@ -199,16 +535,16 @@ void rotate_z_1degree(rack* rp, enum RotationDirection direction)
     /* Rotate by one degree. */
     if (direction == CLOCKWISE)
     {
-        stepper_motor_step(&(*rp)->zmotor, ONE_DEGREE_Z);
-        (*rp)->cur_z++;
+        step_axis(rp, 'z',
+                  degrees_to_steps((*rp)->cur_z + 1, STEPS_PER_DEGREE_Z));
     }
     else if (direction == ANTICLOCKWISE)
     {
         /* Check if the rack isi not already at maximum rotation. */
         if (button_get_state_raw((*rp)->limit_switch) == HIGH)
         {
-            stepper_motor_step(&(*rp)->zmotor, -ONE_DEGREE_Z);
-            (*rp)->cur_z--;
+            step_axis(rp, 'z',
+                      degrees_to_steps((*rp)->cur_z - 1, STEPS_PER_DEGREE_Z));
         }
         else
         {
@@ -218,22 +554,6 @@ void rotate_z_1degree(rack* rp, enum RotationDirection direction)
     }
 }
 
-/**
- * This function uses a limit switch to rotate the z axis to -90 degrees.
- */
-void reset_z(rack* rp)
-{
-    /* Rotate the z axis to -90 degrees. */
-    while (button_get_state_raw((*rp)->limit_switch) == HIGH)
-    {
-        rotate_z_1degree(rp, ANTICLOCKWISE);
-    }
-    (*rp)->cur_z = -(*rp)->max_z;
-    
-    /* Write the z axis' position to disk. */
-    store_degree_of_rotation("../../cur_z.txt", (*rp)->cur_z);
-}
-
 /**
  * This function rotates the rack provided to by one degree it on its x axis.
  */
@@ -242,70 +562,58 @@ void rotate_x_1degree(rack* rp, enum RotationDirection direction )
     /* Rotate by one degree. */
     if (direction == CLOCKWISE)
     {
-        stepper_motor_step(&(*rp)->xmotor, ONE_DEGREE_X);
-        (*rp)->cur_x++;
+        step_axis(rp, 'x',
+                  degrees_to_steps((*rp)->cur_x + 1, STEPS_PER_DEGREE_X));
     }
     else if (direction == ANTICLOCKWISE)
     {
-        stepper_motor_step(&(*rp)->xmotor, -ONE_DEGREE_X);
-        (*rp)->cur_x--;
+        step_axis(rp, 'x',
+                  degrees_to_steps((*rp)->cur_x - 1, STEPS_PER_DEGREE_X));
     }
 }
 
 /**
- * This function rotates the axis corresponding to the char passed to
- * the function to the target angle that is also passed to the function.
+ * This function steps the axis corresponding to the char passed to the
+ * function towards the angle that is also passed to it, taking no more than
+ * one update's worth of steps. It returns true once the axis is at the
+ * angle.
  */
-void rotate_axis(rack* rp, char axis, int target)
+bool rotate_axis_tick(rack* rp, char axis, int target)
 {
-    /* This is the direction of rotation. */
-    enum RotationDirection dir;
-
-    /* This is the total number of degrees to rotate. */
-    int dtotal;
+    /* This is the step position of the axis. */
+    long current;
 
-    /* This keeps track of the number of degrees the axis has rotated. */
-    int dcount;
+    /* This is the step position of the target angle. */
+    long target_steps;
 
-    /* This is the current angle. */
-    int* dcurrent;
+    /* This is the most steps the axis takes. */
+    long chunk = steps_per_tick(rp, (*rp)->step_rate);
 
-    /* This is the name of the file that stores the current rotation
-     * of the axis. */
-    char* fname;
-    
-    /* Get references to the correct axis. */
+    /* Work out where the axis is and where it is going. */
     if (axis == 'x')
-        dcurrent = &(*rp)->cur_x;
-    else
-        dcurrent = &(*rp)->cur_z;
-    
-    /* Calculate the number of degrees the axis needs to rotate. */
-    dtotal = abs(*dcurrent - target);
-
-    /* Determine which direction to rotate. */
-    if (*dcurrent < target)
-        dir = CLOCKWISE;
+    {
+        current = (*rp)->x_steps;
+        target_steps = degrees_to_steps(target, STEPS_PER_DEGREE_X);
+    }
     else
-        dir = ANTICLOCKWISE;
-
-    /* Rotate the axis. */
-    for (dcount = 0; dcount < dtotal; dcount++)
     {
-        if (axis =='x')
-            rotate_x_1degree(rp, dir);
-        else
-            rotate_z_1degree(rp, dir);
+        current = (*rp)->z_steps;
+        target_steps = degrees_to_steps(target, STEPS_PER_DEGREE_Z);
     }
 
-    /* Create the file name. */
-    strfmt(&fname, "../../cur_%c.txt", axis);
-
-    /* Write the current degree of rotation to a file. */
-    store_degree_of_rotation(fname, *dcurrent);
+    /* Only go part of the way if it is far. */
+    if (target_steps > current + chunk)
+        target_steps = current + chunk;
+    else if (target_steps < current - chunk)
+        target_steps = current - chunk;
+    step_axis(rp, axis, target_steps);
 
-    /* De-allocate memory from the file name. */
-    free(fname);
+    /* Check if the axis has arrived. */
+    if (axis == 'x')
+        return (*rp)->cur_x == target
+            && (*rp)->x_steps == degrees_to_steps(target, STEPS_PER_DEGREE_X);
+    return (*rp)->cur_z == target
+        && (*rp)->z_steps == degrees_to_steps(target, STEPS_PER_DEGREE_Z);
 }
 
 /**
@@ -349,7 +657,7 @@ position get_closest_position(rack* rp, position current)
     min = mapped_x + ((*rp)->max_z * 2 * ONE_DEGREE_Z);
 
     /* Work out the next closest position. */
-    for (p = 0; p < 7; p++)
+    for (p = 0; p < (*rp)->num_positions; p++)
     {
         /* Don't check previously visited positions. */
         if (!(*rp)->positions[p].visited)
@@ -388,62 +696,735 @@ position get_closest_position(rack* rp, position current)
 }
 
 /**
- * This function moves the rack so its solar panels are pointing in the
- * direction of the brightest light.
+ * This function marks the position provided to it as visited and returns
+ * true, if it is one of the rack's unvisited positions.
  */
-void light_search(rack* rp)
+bool visit_position(rack* rp, position target)
 {
-    /* This is the current position of the rack. */
-    position current;
+    int p;
 
-    /* This is the position of the rack that is pointed towards the brightest
-     * bit of light. */
-    position brightest;
+    for (p = 0; p < (*rp)->num_positions; p++)
+    {
+        if ((*rp)->positions[p].x == target.x
+            && (*rp)->positions[p].z == target.z
+            && !(*rp)->positions[p].visited)
+        {
+            (*rp)->positions[p].visited = true;
+            return true;
+        }
+    }
 
-    reset_z(rp);
+    return false;
+}
 
-    /* Get the current position of the rack. */ 
-    current.x = get_degree_of_rotation("../../cur_x.txt");
-    current.z = get_degree_of_rotation("../../cur_z.txt");
+/**
+ * This function returns the next position a light search should visit
+ * after the position passed to it, and marks it as visited. An early
+ * stopping search visits the position chosen most often by past searches
+ * at this time of day next, and otherwise the closest position.
+ */
+position get_next_position(rack* rp, position current, time_t now)
+{
+    /* This is the position with the highest confidence. */
+    int best;
 
+    /* This is the confidence of the position being checked. */
+    double confidence;
 
-    /* Work out the brightest position. */
-    for (int i = 0; i < 7; i++)
+    /* This is the highest confidence found. */
+    double max;
+
+    int p;
+
+    if ((*rp)->search_mode == EARLY_STOP_SEARCH)
     {
-        /* Get the next closest position to the current position. */
-        current = get_closest_position(rp, current);
+        /* Find the unvisited position chosen most often. */
+        best = -1;
+        max = 0;
+        for (p = 0; p < (*rp)->num_positions; p++)
+        {
+            if (!(*rp)->positions[p].visited)
+            {
+                confidence = light_map_confidence((*rp)->map, now,
+                                                  (*rp)->positions[p].x,
+                                                  (*rp)->positions[p].z);
+                if (confidence > max)
+                {
+                    max = confidence;
+                    best = p;
+                }
+            }
+        }
 
-        /* Move to the next position. */
-        rotate_axis(rp, 'x', current.x);
-        rotate_axis(rp, 'z', current.z);
-        printf("%d of 7: ", i + 1);
+        /* Visit it if anything is known about it. */
+        if (best != -1)
+        {
+            (*rp)->positions[best].visited = true;
+            return (*rp)->positions[best];
+        }
+    }
 
-        /* Read the light sensor. */
-        if (ldr_read((*rp)->l))
+    /* Nothing is known so visit the closest position. */
+    return get_closest_position(rp, current);
+}
+
+/**
+ * This function returns the number of steps both of the rack's axes need
+ * to take between the positions provided to it.
+ */
+long steps_between(position from, position to)
+{
+    return labs(degrees_to_steps(to.x, STEPS_PER_DEGREE_X)
+                - degrees_to_steps(from.x, STEPS_PER_DEGREE_X))
+         + labs(degrees_to_steps(to.z, STEPS_PER_DEGREE_Z)
+                - degrees_to_steps(from.z, STEPS_PER_DEGREE_Z));
+}
+
+/**
+ * This function starts a light search of the rack provided to it. The
+ * search is carried out a little at a time by light_search_tick().
+ */
+void light_search_start(rack* rp)
+{
+    /* This is the light search. */
+    light_search_task* search = &(*rp)->search;
+
+    /* Don't start a search if one is already running. */
+    if (search->stage != SEARCH_IDLE)
+        return;
+
+    /* The search starts by homing the z axis. */
+    TASK_RESET(&search->t);
+    search->stage = SEARCH_HOMING;
+    search->visited = 0;
+    search->total = (*rp)->num_positions;
+    search->confidence = 0;
+    search->now = wall_time();
+    search->best_reading = (ldr_reading) { false, 0, 0 };
+    (*rp)->skipped_moves = 0;
+    (*rp)->skipped_steps = 0;
+}
+
+/**
+ * This function returns the most degrees apart two neighbouring positions
+ * of a search grid are, on an axis that rotates max degrees either way and
+ * has num positions spread along it. The positions are rounded down to
+ * whole degrees, so some gaps are a degree wider than others.
+ */
+int grid_spacing(int max, int num)
+{
+    if (num <= 1)
+        return 2 * max;
+    return (2 * max + num - 2) / (num - 1);
+}
+
+/**
+ * This function starts a light search of the rack provided to it that only
+ * visits the positions next to the one it is pointing at.
+ */
+void light_search_start_local(rack* rp)
+{
+    int p;
+
+    /* Don't start a search if one is already running. */
+    if ((*rp)->search.stage != SEARCH_IDLE)
+        return;
+    light_search_start(rp);
+
+    /* Skip every position more than one position away on either axis. */
+    for (p = 0; p < (*rp)->num_positions; p++)
+    {
+        if (abs((*rp)->positions[p].x - (*rp)->cur_x)
+                > grid_spacing((*rp)->max_x, (*rp)->num_x)
+            || abs((*rp)->positions[p].z - (*rp)->cur_z)
+                > grid_spacing((*rp)->max_z, (*rp)->num_z))
         {
-            /* Record the brightest reading. */
-            printf("brightest recorded so far\n");
-            brightest.x = current.x;
-            brightest.z = current.z;
+            (*rp)->positions[p].visited = true;
+            (*rp)->search.total--;
         }
-        else
+    }
+}
+
+/**
+ * This function plans the first position a light search of the rack
+ * provided to it visits.
+ */
+void light_search_plan(rack* rp)
+{
+    /* This is the light search. */
+    light_search_task* search = &(*rp)->search;
+
+    /* This is the position predicted to be the brightest. */
+    position predicted;
+
+    /* Get the current position of the rack. */ 
+    search->current.x = (*rp)->cur_x;
+    search->current.z = (*rp)->cur_z;
+
+    /* Start at the position the light map predicts is the brightest at
+     * this time of day, or else at the closest position, and treat it as
+     * the brightest until a reading says otherwise. */
+    search->has_prediction =
+        light_map_predict((*rp)->map, search->now, &predicted.x, &predicted.z)
+        && visit_position(rp, predicted);
+    if (search->has_prediction)
+    {
+        search->current = predicted;
+        search->predicted = predicted;
+    }
+    else
+        search->current = get_closest_position(rp, search->current);
+    search->brightest = search->current;
+}
+
+/**
+ * This function records the reading the light search of the rack provided
+ * to it made at its current position. It returns true if the search has
+ * made enough readings.
+ */
+bool light_search_record(rack* rp, ldr_reading reading)
+{
+    /* This is the light search. */
+    light_search_task* search = &(*rp)->search;
+
+    /* This is the sample for the light map. */
+    light_sample* sample = &search->samples[search->visited];
+
+    /* Remember the reading for the light map. */
+    *sample = (light_sample) {
+        .time = wall_time(),
+        .x = steps_to_degrees(reading.x_steps, STEPS_PER_DEGREE_X),
+        .z = steps_to_degrees(reading.z_steps, STEPS_PER_DEGREE_Z),
+        .brightest = reading.brightest,
+        .chosen = false
+    };
+    search->visited++;
+
+    /* Check the light sensor's reading. */
+    if (reading.brightest)
+    {
+        /* Record the brightest reading at the position it was
+         * requested at. */
+        search->best_reading = reading;
+        search->brightest.x = sample->x;
+        search->brightest.z = sample->z;
+    }
+    LOG_INFO("search_reading", LOG_INT("position", search->visited),
+             LOG_INT("total", search->total), LOG_INT("x", sample->x),
+             LOG_INT("z", sample->z),
+             LOG_STR("result", reading.brightest ? "brightest" : "dimmer"));
+
+    /* Check if every position has been visited. */
+    if (search->visited == search->total)
+        return true;
+
+    /* Stop early once the positions visited so far are where past
+     * searches at this time of day nearly always ended up, but only if
+     * today's readings agree with the light map. The predicted position
+     * has to still be the brightest after at least one other reading, as
+     * the arduino only says whether a reading beats the ones before it. */
+    search->confidence += light_map_confidence((*rp)->map, search->now,
+                                               sample->x, sample->z);
+    if ((*rp)->search_mode == EARLY_STOP_SEARCH
+        && search->has_prediction && search->visited > 1
+        && search->brightest.x == search->predicted.x
+        && search->brightest.z == search->predicted.z
+        && search->confidence >= (*rp)->search_confidence)
+    {
+        /* Work out how much moving stopping early saved, following the
+         * path the rest of the search would have taken. */
+        (*rp)->skipped_moves = search->total - search->visited;
+        (*rp)->skipped_steps = steps_between(search->current, search->next);
+        for (int i = search->visited + 1; i < search->total; i++)
         {
-            printf("dimmer\n");
+            search->current = search->next;
+            search->next = get_closest_position(rp, search->current);
+            (*rp)->skipped_steps += steps_between(search->current,
+                                                  search->next);
         }
+        LOG_INFO("search_stopped_early",
+                 LOG_INT("skipped_moves", (*rp)->skipped_moves),
+                 LOG_INT("skipped_steps", (*rp)->skipped_steps));
+        return true;
     }
 
-    
-    /* Move to the brightest position. */
-    printf("moving to the brightest postion\n");
-    rotate_axis(rp, 'x', brightest.x);
-    reset_z(rp);    /* Ensure the z axis rotates accurately. */
-    rotate_axis(rp, 'z', brightest.z);
+    return false;
+}
+
+/**
+ * This function finishes the light search of the rack provided to it once
+ * the rack is at the brightest position.
+ */
+void light_search_finish(rack* rp)
+{
+    /* This is the light search. */
+    light_search_task* search = &(*rp)->search;
 
     /* Reset all positions to unvisited in preparation for the next search. */
-    for (int p = 0; p < 7; p++)
+    for (int p = 0; p < (*rp)->num_positions; p++)
     {
         (*rp)->positions[p].visited = false;
     }
+
+    /* Add the readings to the light map, marking the one that was
+     * chosen. */
+    for (int i = 0; i < search->visited; i++)
+    {
+        search->samples[i].chosen = search->samples[i].x == search->brightest.x
+                                 && search->samples[i].z == search->brightest.z;
+        light_map_add(&(*rp)->map, search->samples[i]);
+    }
+
+    /* Remember the result of the search. */
+    (*rp)->cache.valid = true;
+    (*rp)->cache.best = search->brightest;
+    (*rp)->cache.reading = search->best_reading;
+    (*rp)->cache.falls = 0;
+    start_timer(&(*rp)->cache.time);
+
+    search->stage = SEARCH_IDLE;
+}
+
+/**
+ * This function cancels the light search of the rack provided to it,
+ * leaving the rack where it is.
+ */
+void light_search_cancel(rack* rp)
+{
+    /* Check if a search is running. */
+    if ((*rp)->search.stage == SEARCH_IDLE)
+        return;
+
+    /* Stop any reading the arduino is making and any homing. */
+    ldr_cancel(&(*rp)->l);
+    TASK_RESET(&(*rp)->homing);
+    stepper_motor_steps_per_sec(&(*rp)->zmotor, (*rp)->step_rate);
+
+    /* Reset all positions to unvisited in preparation for the next search. */
+    for (int p = 0; p < (*rp)->num_positions; p++)
+    {
+        (*rp)->positions[p].visited = false;
+    }
+
+    /* The rack isn't pointing at the brightest light. */
+    (*rp)->cache.valid = false;
+    (*rp)->search.stage = SEARCH_IDLE;
+    store_position(rp);
+    LOG_INFO("search_cancelled");
+}
+
+/**
+ * This function runs the light search of the rack provided to it, a little
+ * more every time it is called, so that a search can run over many updates
+ * while the rest of the rover keeps running. It returns TASK_DONE once the
+ * rack is pointing at the brightest position.
+ */
+enum TaskStatus light_search_run(rack* rp)
+{
+    /* This is the light search. */
+    light_search_task* search = &(*rp)->search;
+
+    TASK_BEGIN(&search->t);
+
+    /* Home the z axis so it rotates accurately. */
+    search->stage = SEARCH_HOMING;
+    TASK_AWAIT_TASK(&search->t, home_z_task(rp));
+    light_search_plan(rp);
+
+    while (true)
+    {
+        /* Move to the next position. */
+        search->stage = SEARCH_MOVING;
+        TASK_AWAIT(&search->t, rotate_axis_tick(rp, 'x', search->current.x)
+                               && rotate_axis_tick(rp, 'z', search->current.z));
+        store_position(rp);
+
+        /* Ask the arduino for a reading tagged with where the rack is, and
+         * plan the next move while it makes it. */
+        ldr_request(&(*rp)->l, (*rp)->x_steps, (*rp)->z_steps);
+        if (search->visited < search->total - 1)
+            search->next = get_next_position(rp, search->current, search->now);
+
+        /* Collect the reading once the arduino has made it. */
+        search->stage = SEARCH_READING;
+        TASK_AWAIT(&search->t, ldr_is_ready((*rp)->l));
+        if (light_search_record(rp, ldr_complete(&(*rp)->l)))
+            break;
+        search->current = search->next;
+    }
+
+    /* Move to the brightest position. */
+    LOG_INFO("search_returning", LOG_INT("x", search->brightest.x),
+             LOG_INT("z", search->brightest.z));
+    search->stage = SEARCH_RETURNING;
+    TASK_AWAIT(&search->t, rotate_axis_tick(rp, 'x', search->brightest.x)
+                           && rotate_axis_tick(rp, 'z', search->brightest.z));
+    store_position(rp);
+    light_search_finish(rp);
+
+    TASK_END(&search->t);
+}
+
+/**
+ * This function does the next part of the light search of the rack
+ * provided to it. It returns true while the search is still running.
+ */
+bool light_search_tick(rack* rp)
+{
+    if ((*rp)->search.stage != SEARCH_IDLE)
+        light_search_run(rp);
+    return (*rp)->search.stage != SEARCH_IDLE;
+}
+
+/**
+ * This function returns true if the result of the last light search of the
+ * rack provided to it can no longer be trusted, without making a reading.
+ */
+bool search_cache_is_stale(rack* rp)
+{
+    /* This is the result of the last search. */
+    search_cache* cache = &(*rp)->cache;
+
+    /* Check if there is a result, and that the rack hasn't been moved
+     * away from it since. */
+    if (!cache->valid
+        || (*rp)->cur_x != cache->best.x || (*rp)->cur_z != cache->best.z)
+        return true;
+
+    /* Check if the light has kept falling where the rack is pointing. */
+    if (cache->falls >= SEARCH_CACHE_FALLS)
+        return true;
+
+    /* Check if the sun is predicted to have moved too far since. */
+    return check_timer(cache->time, SEARCH_CACHE_SUN_TOLERANCE * NANOS_PER_HOUR
+                                    / SUN_DEGREES_PER_HOUR);
+}
+
+/**
+ * This function counts the reading provided to it, made where the rack
+ * provided to it is pointing, against the result of its last light search.
+ * The arduino only says whether a reading beats the brightest of its
+ * series, which includes the reading the search settled on. A reading that
+ * doesn't beat it means the light has fallen, or at best stayed the same,
+ * so only several in a row are taken to mean it has fallen. This function
+ * returns true if the reading beat it, which means the light has got
+ * brighter.
+ */
+bool search_cache_record(rack* rp, ldr_reading reading)
+{
+    if (reading.brightest)
+        (*rp)->cache.falls = 0;
+    else
+        (*rp)->cache.falls++;
+    return reading.brightest;
+}
+
+/**
+ * This function starts checking whether the result of the last light
+ * search of the rack provided to it can still be trusted. If it can't
+ * without a reading, it searches again straight away. Otherwise it asks the
+ * arduino for a single reading where the rack is pointing, which
+ * search_cache_check_tick() collects.
+ */
+void search_cache_check(rack* rp)
+{
+    /* Don't check twice at once. */
+    if ((*rp)->cache.checking)
+        return;
+
+    if (search_cache_is_stale(rp))
+    {
+        light_search_start(rp);
+        return;
+    }
+
+    ldr_request(&(*rp)->l, (*rp)->x_steps, (*rp)->z_steps);
+    (*rp)->cache.checking = true;
+}
+
+/**
+ * This function collects the reading checking the result of the last light
+ * search of the rack provided to it, once the arduino has made it, and
+ * searches again if the light has got brighter or kept falling since.
+ */
+void search_cache_check_tick(rack* rp)
+{
+    /* This is the reading made where the rack is pointing. */
+    ldr_reading reading;
+
+    if (!(*rp)->cache.checking || !ldr_is_ready((*rp)->l))
+        return;
+    reading = ldr_complete(&(*rp)->l);
+    (*rp)->cache.checking = false;
+
+    if (search_cache_record(rp, reading) || search_cache_is_stale(rp))
+        light_search_start(rp);
+    else
+        LOG_INFO("search_still_current");
+}
+
+/**
+ * This function abandons any reading being made to check the result of the
+ * last light search of the rack provided to it.
+ */
+void search_cache_abort_check(rack* rp)
+{
+    if ((*rp)->cache.checking)
+    {
+        ldr_cancel(&(*rp)->l);
+        (*rp)->cache.checking = false;
+    }
+}
+
+/**
+ * This function abandons any sample the tracking of the rack provided to
+ * it is making, so the light dependant resistor can be used for something
+ * else.
+ */
+void tracking_abort_sample(rack* rp)
+{
+    if ((*rp)->tracking.sampling)
+    {
+        ldr_cancel(&(*rp)->l);
+        (*rp)->tracking.sampling = false;
+        TASK_RESET(&(*rp)->tracking.t);
+    }
+}
+
+/**
+ * This function stops the tracking of the rack provided to it until the
+ * operator turns it back on, so it doesn't undo what they have done.
+ */
+void tracking_pause(rack* rp)
+{
+    tracking_abort_sample(rp);
+    (*rp)->tracking.enabled = false;
+}
+
+/**
+ * This function keeps the rack provided to it pointed at the light, a
+ * little more every time it is called. Every so often it makes a single
+ * reading where the rack is pointing, and it only searches again when the
+ * readings keep saying the light has fallen or the sun is predicted to
+ * have moved too far. It never finishes.
+ */
+enum TaskStatus tracking_run(rack* rp)
+{
+    /* This is the tracking of the light. */
+    tracker* tracking = &(*rp)->tracking;
+
+    /* This is the sample reading. */
+    ldr_reading reading;
+
+    TASK_BEGIN(&tracking->t);
+
+    while (true)
+    {
+        /* Wait until it is time for a sample, then ask the arduino for
+         * it. */
+        TASK_SLEEP(&tracking->t, TRACKING_INTERVAL);
+        ldr_request(&(*rp)->l, (*rp)->x_steps, (*rp)->z_steps);
+        tracking->sampling = true;
+
+        /* Wait for the arduino to make it. */
+        TASK_AWAIT(&tracking->t, ldr_is_ready((*rp)->l));
+        reading = ldr_complete(&(*rp)->l);
+        tracking->sampling = false;
+
+        /* A sample that beats the last search's reading means the light
+         * has only got brighter, which doesn't need the rack to move.
+         * Only searching again once several samples in a row have fallen
+         * stops one dim moment, such as a passing cloud, from starting a
+         * search. */
+        search_cache_record(rp, reading);
+
+        /* Search everywhere if the rack has never searched or was moved
+         * since, which can only be before the operator turned tracking
+         * on. */
+        if (!(*rp)->cache.valid
+            || (*rp)->cur_x != (*rp)->cache.best.x
+            || (*rp)->cur_z != (*rp)->cache.best.z)
+            light_search_start(rp);
+
+        /* Only search the positions nearby if the light has fallen, or if
+         * the sun is predicted to have moved too far since the last
+         * search. */
+        else if (search_cache_is_stale(rp))
+            light_search_start_local(rp);
+    }
+
+    TASK_END(&tracking->t);
+}
+
+/**
+ * This function does the next part of keeping the rack provided to it
+ * pointed at the light, if the light is being tracked.
+ */
+void tracking_tick(rack* rp)
+{
+    if ((*rp)->tracking.enabled)
+        tracking_run(rp);
+}
+
+/**
+ * This function returns true if the rack provided to it is tracking the
+ * light by itself. It only does once the operator turns tracking on, and
+ * stops when they cancel a light search or move the rack by hand.
+ */
+bool rack_is_tracking(rack r)
+{
+    return r->tracking.enabled;
+}
+
+/**
+ * This function returns how many steps the z axis of the rack provided to
+ * it was from where it was thought to be the last time it was homed.
+ */
+long rack_get_z_home_error(rack r)
+{
+    return r->z_home_error;
+}
+
+/**
+ * This function returns the stage the light search of the rack provided to
+ * it is at, storing the number of the position being visited in position
+ * and the number of positions in num_positions.
+ */
+enum SearchStage rack_get_search_stage(rack r, int* position,
+                                               int* num_positions)
+{
+    *position = r->search.visited + 1;
+    *num_positions = r->search.total;
+    return r->search.stage;
+}
+
+/**
+ * This function sets the way the rack provided to it searches for light.
+ * An early stopping search stops once the positions it has visited were
+ * chosen by at least the confidence fraction of past searches at this
+ * time of day, and the position predicted to be brightest is still the
+ * brightest it has read. A rack does a full search until this is called.
+ */
+void rack_set_search_mode(rack* rp, enum SearchMode mode, double confidence)
+{
+    (*rp)->search_mode = mode;
+    (*rp)->search_confidence = confidence;
+}
+
+/**
+ * This function stores how many moves, and how many steps, the last light
+ * search of the rack provided to it skipped by stopping early.
+ */
+void rack_get_search_savings(rack r, int* moves, long* steps)
+{
+    *moves = r->skipped_moves;
+    *steps = r->skipped_steps;
+}
+
+/**
+ * This function stores the positions a full light search of the rack
+ * provided to it would visit from x and z degrees, in the order it would
+ * visit them, and returns how many there are.
+ */
+int rack_plan_search(rack* rp, int x, int z, int* xs, int* zs)
+{
+    position current = { x, z, false };     /* The position being planned
+                                             * from. */
+    int p;
+
+    /* Visit the closest position that hasn't been visited until every
+     * position has been. */
+    for (p = 0; p < (*rp)->num_positions; p++)
+    {
+        current = get_closest_position(rp, current);
+        xs[p] = current.x;
+        zs[p] = current.z;
+    }
+
+    /* Leave every position unvisited for the next search. */
+    for (p = 0; p < (*rp)->num_positions; p++)
+        (*rp)->positions[p].visited = false;
+
+    return (*rp)->num_positions;
+}
+
+/**
+ * This function sets the positions a light search of the rack provided to
+ * it visits to a grid of num_x columns across the x axis' rotation and num_z
+ * rows across the z axis'. The edges layout only keeps the middle of the z
+ * axis in the columns between the outermost two.
+ */
+void rack_set_search_grid(rack* rp, int num_x, int num_z,
+                          enum SearchLayout layout)
+{
+    int i, j, x, z;
+
+    /* Allocate memory to the array of positions, which is as big as it can
+     * be if every position of the grid is used. */
+    free((*rp)->positions);
+    free((*rp)->search.samples);
+    (*rp)->positions = (position*) malloc(sizeof(position) * num_x * num_z);
+    (*rp)->search.samples =
+        (light_sample*) malloc(sizeof(light_sample) * num_x * num_z);
+
+    /* Initialise the positions, spreading them evenly from one end of each
+     * axis to the other. */
+    (*rp)->num_x = num_x;
+    (*rp)->num_z = num_z;
+    (*rp)->num_positions = 0;
+    for (i = 0; i < num_x; i++)
+    {
+        x = num_x == 1 ? 0 : -(*rp)->max_x + 2 * (*rp)->max_x * i / (num_x - 1);
+        for (j = 0; j < num_z; j++)
+        {
+            z = num_z == 1 ? 0
+                : -(*rp)->max_z + 2 * (*rp)->max_z * j / (num_z - 1);
+
+            /* Only use the middle of the z axis between the outermost
+             * columns of the edges layout. */
+            if (layout == EDGES_LAYOUT && i > 0 && i < num_x - 1)
+            {
+                if (j > 0)
+                    break;
+                z = 0;
+            }
+
+            (*rp)->positions[(*rp)->num_positions].x = x;
+            (*rp)->positions[(*rp)->num_positions].z = z;
+            (*rp)->positions[(*rp)->num_positions].visited = false;
+            (*rp)->num_positions++;
+        }
+    }
+}
+
+/**
+ * This function sets the rate, in steps per second, the motors of the rack
+ * provided to it normally rotate at.
+ */
+void rack_set_step_rate(rack* rp, unsigned int steps_per_sec)
+{
+    (*rp)->step_rate = steps_per_sec;
+    stepper_motor_steps_per_sec(&(*rp)->zmotor, steps_per_sec);
+    stepper_motor_steps_per_sec(&(*rp)->xmotor, steps_per_sec);
+}
+
+/**
+ * This function sets the time, in nano-seconds, between the updates of the
+ * rack provided to it, which decides how many steps its axes take in each
+ * update while a light search is running.
+ */
+void rack_set_frame_time(rack* rp, uint64_t frame_time)
+{
+    (*rp)->frame_time = frame_time;
+}
+
+/**
+ * This function sets the minimum amount of time, in nano-seconds, between
+ * writes of the position of the rack provided to it to its journal.
+ */
+void rack_set_journal_interval(rack* rp, uint64_t interval)
+{
+    journal_set_write_interval(&(*rp)->j, interval);
 }
 
 /**
@@ -454,6 +1435,30 @@ void rack_update(rack* rp, enum RackCommand rack_command)
     /* Update the button. */
     button_update(&(*rp)->limit_switch);
 
+    /* The operator cancelling a search, or moving the rack by hand, stops
+     * tracking from searching again behind their back. */
+    if (rack_command == CANCEL_LIGHT_SEARCH
+        || rack_command == X_CLOCKWISE || rack_command == X_ANTICLOCKWISE
+        || rack_command == Z_CLOCKWISE || rack_command == Z_ANTICLOCKWISE)
+    {
+        search_cache_abort_check(rp);
+        tracking_pause(rp);
+    }
+
+    /* Collect the reading checking the last search's result, if it has
+     * been made. */
+    search_cache_check_tick(rp);
+
+    /* While a light search is running only cancelling it is allowed. */
+    if ((*rp)->search.stage != SEARCH_IDLE)
+    {
+        if (rack_command == CANCEL_LIGHT_SEARCH)
+            light_search_cancel(rp);
+        else
+            light_search_tick(rp);
+        rack_command = NO_RACK_COMMAND;
+    }
+
     /* Execute the rack command. */ 
     switch (rack_command)
     {
@@ -470,10 +1475,24 @@ void rack_update(rack* rp, enum RackCommand rack_command)
             rotate_z_1degree(rp, ANTICLOCKWISE);
             break;
         case LIGHT_SEARCH:
-            light_search(rp);
+            /* Only search again if the last result is stale. */
+            tracking_abort_sample(rp);
+            search_cache_check(rp);
             break;
+        case TOGGLE_TRACKING :
+            tracking_abort_sample(rp);
+            (*rp)->tracking.enabled = !(*rp)->tracking.enabled;
+            break;
+        case CANCEL_LIGHT_SEARCH :
         case NO_RACK_COMMAND :
             NULL;
             break;
     }
+
+    /* Track the light when nothing else is using the rack. */
+    if ((*rp)->search.stage == SEARCH_IDLE && !(*rp)->cache.checking)
+        tracking_tick(rp);
+
+    /* Journal the position of the rack if it is due. */
+    store_position(rp);
 }
@@ -18,6 +18,10 @@
 #include "mycutils.h"
 #include "ldr.h"
 #include "button.h"
+#include "journal.h"
+#include "light_map.h"
+#include "task.h"
+#include "logger.h"
 
 /* Judging from the 3d models simulations in blender, 7.5 revolutions
  * of the worm gear equals 1 revolution of the spur gear.
@@ -38,6 +42,85 @@
  * 3138 steps / 360 degress = ~9 steps per degree of the internal gear. */
 #define ONE_DEGREE_Z 9
 
+/* ONE_DEGREE_X and ONE_DEGREE_Z are truncated, so moving by them adds a
+ * little error with every degree. Positions are instead kept as absolute
+ * step counts and converted to and from degrees using these fixed-point
+ * numbers of steps per degree, which have STEPS_FRAC_BITS fractional bits.
+ * 204800 / 360 = 568.888... steps per degree of the x axis.
+ * 2048 * 95 / 62 / 360 = 8.716845... steps per degree of the z axis. */
+#define STEPS_FRAC_BITS 32
+#define STEPS_ONE ((int64_t) 1 << STEPS_FRAC_BITS)
+#define STEPS_PER_DEGREE_X ((int64_t) 2443359172836)
+#define STEPS_PER_DEGREE_Z ((int64_t) 37438567971)
+
+/* These are the pins of the rack's hardware. The stepper motors' pins are
+ * in the order of their coils, and the ldr's are the pin that asks the
+ * arduino for a reading, the pin it says it is ready on and the pin it
+ * says the reading was the brightest on. */
+#define RACK_ZMOTOR_PINS 26, 20, 19, 16
+#define RACK_XMOTOR_PINS 22, 10, 24, 9
+#define RACK_LDR_PINS 14, 15, 18
+#define RACK_LIMIT_SWITCH_PIN 1
+
+/* This is the rate, in steps per second, the rack's motors normally
+ * rotate at. */
+#define RACK_STEPS_PER_SEC 400
+
+/* This is the time, in nano-seconds, between updates of the rack unless
+ * it is told otherwise. It is the rover's frame. */
+#define RACK_FRAME_TIME (NANOS_PER_SEC / 2)
+
+/* This is the percentage of the time between updates an axis spends
+ * stepping in one update while a light search is running, so the motors
+ * keep moving without holding the rest of the rover up. */
+#define RACK_TICK_PERCENT 75
+
+/* These are the rates, in steps per second, the z axis approaches its
+ * limit switch at while homing. The fast approach runs to just short of
+ * where the switch should be, as fast as the motor can be stepped without
+ * stalling, and the slow one finds its exact trigger point. */
+#define Z_HOMING_FAST_RATE 800
+#define Z_HOMING_SLOW_RATE 100
+
+/* This is the number of steps short of the limit switch the fast approach
+ * stops, and the number the z axis backs away from the switch if it is
+ * already pressed. */
+#define Z_HOMING_BACKOFF (3 * ONE_DEGREE_Z)
+
+/* This is the number of nano-seconds in an hour. */
+#define NANOS_PER_HOUR (3600ULL * NANOS_PER_SEC)
+
+/* This is how many degrees the sun moves across the sky every hour. */
+#define SUN_DEGREES_PER_HOUR 15
+
+/* This is how many degrees the sun can be predicted to have moved since
+ * the last light search before its result is searched for again. */
+#define SEARCH_CACHE_SUN_TOLERANCE 5
+
+/* This is the file the position of the rack is journaled to. */
+#define RACK_JOURNAL "../../rack.journal"
+
+/* This is the time, in nano-seconds, between the single readings the rack
+ * makes to check it is still pointing at the light while tracking it. */
+#define TRACKING_INTERVAL (60ULL * NANOS_PER_SEC)
+
+/* This is the number of readings in a row, made where the rack is pointing,
+ * that must say the light has fallen before the result of the last light
+ * search is searched for again. */
+#define SEARCH_CACHE_FALLS 10
+
+/* This is the default fraction of past light searches the visited
+ * positions must have been chosen by before an early stopping search
+ * stops. */
+#define SEARCH_CONFIDENCE 0.9
+
+/* This is the file the readings of light searches are stored in. */
+#define RACK_LIGHT_MAP "../../light_map.bin"
+
+/* This is the default minimum amount of time, in nano-seconds, between
+ * writes of the rack's position to its journal. */
+#define RACK_JOURNAL_INTERVAL 5000000000
+
 /**
  * These are the directions in which the rack can rotate.
  */
@@ -52,7 +135,39 @@ enum RackCommand {
     X_ANTICLOCKWISE,
     Z_CLOCKWISE,
     Z_ANTICLOCKWISE,
-    LIGHT_SEARCH
+    LIGHT_SEARCH,
+    CANCEL_LIGHT_SEARCH,
+    TOGGLE_TRACKING
+};
+
+/**
+ * These are the stages of a light search.
+ */
+enum SearchStage {
+    SEARCH_IDLE,        /* No search is running. */
+    SEARCH_HOMING,      /* Homing the z axis. */
+    SEARCH_MOVING,      /* Moving to the next position. */
+    SEARCH_READING,     /* Waiting for the arduino to make a reading. */
+    SEARCH_RETURNING    /* Moving to the brightest position. */
+};
+
+/**
+ * These are the ways the rack can search for light.
+ */
+enum SearchMode {
+    FULL_SEARCH,        /* Visit every position. */
+    EARLY_STOP_SEARCH   /* Visit the positions predicted to be brightest
+                         * first and stop once confident. */
+};
+
+/**
+ * These are the ways the positions a light search visits can be laid out.
+ */
+enum SearchLayout {
+    EDGES_LAYOUT,   /* Every position along the outermost columns of the
+                     * x axis, and only the middle of the z axis between
+                     * them. */
+    GRID_LAYOUT     /* Every position of the grid. */
 };
 
 /**
@@ -65,11 +180,91 @@ typedef struct rack_data* rack;
  */
 void rack_init(rack* rp);
 
+/**
+ * This function initialises the rack provided to it, journaling its
+ * position to journal_file and storing the readings of its light searches
+ * in light_map_file.
+ */
+void rack_init_files(rack* rp, char* journal_file, char* light_map_file);
+
 /**
  * This function terminates the rack provided to it.
  */
 void rack_term(rack* rp);
 
+/**
+ * This function returns true if the rack provided to it is tracking the
+ * light by itself. It only does once the operator turns tracking on, and
+ * stops when they cancel a light search or move the rack by hand.
+ */
+bool rack_is_tracking(rack r);
+
+/**
+ * This function returns how many steps the z axis of the rack provided to
+ * it was from where it was thought to be the last time it was homed.
+ */
+long rack_get_z_home_error(rack r);
+
+/**
+ * This function stores the positions a full light search of the rack
+ * provided to it would visit from x and z degrees, in the order it would
+ * visit them, and returns how many there are. xs and zs must have room for
+ * every position of the search grid. It must not be called while a light
+ * search is running.
+ */
+int rack_plan_search(rack* rp, int x, int z, int* xs, int* zs);
+
+/**
+ * This function sets the positions a light search of the rack provided to
+ * it visits to a grid of num_x columns across the x axis' rotation and num_z
+ * rows across the z axis', laid out the way provided. The rack starts with
+ * a 3 by 3 grid in the edges layout, which is 7 positions.
+ */
+void rack_set_search_grid(rack* rp, int num_x, int num_z,
+                          enum SearchLayout layout);
+
+/**
+ * This function sets the rate, in steps per second, the motors of the rack
+ * provided to it normally rotate at.
+ */
+void rack_set_step_rate(rack* rp, unsigned int steps_per_sec);
+
+/**
+ * This function sets the time, in nano-seconds, between the updates of the
+ * rack provided to it, which decides how many steps its axes take in each
+ * update while a light search is running.
+ */
+void rack_set_frame_time(rack* rp, uint64_t frame_time);
+
+/**
+ * This function sets the minimum amount of time, in nano-seconds, between
+ * writes of the position of the rack provided to it to its journal.
+ */
+void rack_set_journal_interval(rack* rp, uint64_t interval);
+
+/**
+ * This function returns the stage the light search of the rack provided to
+ * it is at, storing the number of the position being visited in position
+ * and the number of positions in num_positions.
+ */
+enum SearchStage rack_get_search_stage(rack r, int* position,
+                                               int* num_positions);
+
+/**
+ * This function sets the way the rack provided to it searches for light.
+ * An early stopping search stops once the positions it has visited were
+ * chosen by at least the confidence fraction of past searches at this
+ * time of day, and the position predicted to be brightest is still the
+ * brightest it has read. A rack does a full search until this is called.
+ */
+void rack_set_search_mode(rack* rp, enum SearchMode mode, double confidence);
+
+/**
+ * This function stores how many moves, and how many steps, the last light
+ * search of the rack provided to it skipped by stopping early.
+ */
+void rack_get_search_savings(rack r, int* moves, long* steps);
+
 /**
  * This function updates the rack provided to it.
  */
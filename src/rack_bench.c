@@ -0,0 +1,259 @@
+/**
+ * rack_bench.c
+ *
+ * This file contains the main function for the rack benchmark. It runs the
+ * rack's ways of pointing its solar panels at the light against a model of
+ * the rack and the sky, on the virtual clock, and reports how long the
+ * motors ran, how many steps they took and how far from the sun the panels
+ * pointed.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "rack.h"
+#include "rack_twin.h"
+#include "gpio.h"
+#include "gpio_sim.h"
+#include "mycutils.h"
+
+/* These are the files the rack keeps its journal and light map in while it
+ * is benchmarked, so the rover's own are left alone. */
+#define BENCH_JOURNAL "../../bench.journal"
+#define BENCH_LIGHT_MAP "../../bench_light_map.bin"
+
+/* This is midnight UTC on the first day that is simulated, the 20th of
+ * March 2024. */
+#define BENCH_DATE 1710892800
+
+/* These are the solar hours the rack works between every day. */
+#define BENCH_FIRST_HOUR 7
+#define BENCH_LAST_HOUR 17
+
+/* This is the time, in nano-seconds, between the rack's updates. */
+#define BENCH_FRAME (NANOS_PER_SEC / 2)
+
+/* This is the time, in seconds, between light searches for the ways that
+ * search on a schedule. */
+#define BENCH_SEARCH_INTERVAL 3600
+
+/* This is the time, in seconds, between checks of where the panels are
+ * pointing. */
+#define BENCH_AIM_INTERVAL 60
+
+/* This is the number of days simulated if none is given. */
+#define BENCH_DAYS 3
+
+/* This is the time, in nano-seconds, between writes of the journal. It is
+ * longer than the rover's, as the journal makes no difference here. */
+#define BENCH_JOURNAL_INTERVAL (600ULL * NANOS_PER_SEC)
+
+/**
+ * These are the ways of pointing the panels at the light that are
+ * benchmarked.
+ */
+enum Strategy {
+    FULL_HOURLY,        /* Search every position every hour. */
+    EARLY_STOP_HOURLY,  /* Search every hour, stopping once confident. */
+    TRACKING,           /* Let the rack track the light by itself. */
+    NUM_STRATEGIES
+};
+
+/**
+ * These are the names of the ways of pointing at the light.
+ */
+char* strategy_names[NUM_STRATEGIES] = {
+    "full-hourly", "early-stop-hourly", "tracking"
+};
+
+/**
+ * These are the results of benchmarking one of the ways.
+ */
+typedef struct {
+    char* name;             /* The name of the way. */
+    int searches;           /* The number of light searches. */
+    double search_time;     /* The seconds spent searching. */
+    double aim_sum;         /* The sum of the aim errors checked. */
+    int aim_checks;         /* The number of aim errors checked. */
+    double worst_aim;       /* The worst aim error checked. */
+    rack_twin_stats stats;  /* What the model counted. */
+} bench_result;
+
+/**
+ * This function returns the calendar time that the first day's work
+ * starts at, for the rover where the model provided to it puts it.
+ */
+time_t bench_start_time(rack_twin_config config)
+{
+    time_t start;   /* The start of the first day's work. */
+
+    /* Solar time is ahead of UTC by an hour every 15 degrees east. */
+    start = BENCH_DATE
+        + (time_t) ((BENCH_FIRST_HOUR - config.longitude / 15) * 3600);
+    if (start < BENCH_DATE)
+        start += 24 * 3600;
+    return start;
+}
+
+/**
+ * This function runs the way of pointing at the light provided to it for
+ * a number of days, and returns the results.
+ */
+bench_result bench_run(enum Strategy strategy, int days,
+                       rack_twin_config config)
+{
+    bench_result result = { strategy_names[strategy], 0, 0, 0, 0, 0 };
+    struct timespec frame;      /* The start of the current update. */
+    rack_twin t;                /* The model of the rack and the sky. */
+    rack r;                     /* The rack. */
+    time_t day_start;           /* The start of the day's work. */
+    time_t next_search;         /* When to search next. */
+    time_t next_aim;            /* When to check the aim next. */
+    enum RackCommand command;   /* The command for the rack. */
+    enum SearchStage stage;     /* The stage of the light search. */
+    bool was_searching;         /* Whether the rack was searching. */
+    double aim;                 /* How far from the sun the panels point. */
+    int day, position, num_positions;
+
+    /* Start with a rack that knows nothing, pointing straight up. */
+    remove(BENCH_JOURNAL);
+    remove(BENCH_LIGHT_MAP);
+    rack_twin_init(&t, config);
+    rack_init_files(&r, BENCH_JOURNAL, BENCH_LIGHT_MAP);
+    rack_set_journal_interval(&r, BENCH_JOURNAL_INTERVAL);
+    rack_set_frame_time(&r, BENCH_FRAME);
+    if (strategy == TRACKING)
+        rack_update(&r, TOGGLE_TRACKING);
+    rack_set_search_mode(&r, strategy == FULL_HOURLY ? FULL_SEARCH
+                                                     : EARLY_STOP_SEARCH,
+                         SEARCH_CONFIDENCE);
+    rack_twin_reset_stats(&t);
+
+    day_start = bench_start_time(config);
+    set_wall_time(day_start);
+    for (day = 0; day < days; day++)
+    {
+        /* Wait for the start of the day's work. */
+        get_time(&frame);
+        if (day_start > wall_time())
+            wait_timer(frame, (uint64_t) (day_start - wall_time())
+                              * NANOS_PER_SEC);
+        next_search = day_start;
+        next_aim = day_start;
+        was_searching = false;
+
+        while (wall_time() < day_start
+                             + (BENCH_LAST_HOUR - BENCH_FIRST_HOUR) * 3600)
+        {
+            start_timer(&frame);
+
+            /* Search on the hour, unless the rack is tracking by
+             * itself. */
+            command = NO_RACK_COMMAND;
+            if (strategy != TRACKING && wall_time() >= next_search)
+            {
+                command = LIGHT_SEARCH;
+                next_search += BENCH_SEARCH_INTERVAL;
+            }
+            rack_update(&r, command);
+
+            /* Count the searches and the time spent on them. */
+            stage = rack_get_search_stage(r, &position, &num_positions);
+            if (stage != SEARCH_IDLE)
+            {
+                if (!was_searching)
+                {
+                    result.searches++;
+                    rack_twin_new_series(&t);
+                }
+                result.search_time += (double) BENCH_FRAME / NANOS_PER_SEC;
+            }
+            was_searching = stage != SEARCH_IDLE;
+
+            /* Check how far from the sun the panels are pointing. */
+            if (wall_time() >= next_aim)
+            {
+                aim = rack_twin_aim_error(t);
+                if (aim >= 0)
+                {
+                    result.aim_sum += aim;
+                    result.aim_checks++;
+                    if (aim > result.worst_aim)
+                        result.worst_aim = aim;
+                }
+                next_aim += BENCH_AIM_INTERVAL;
+            }
+
+            wait_timer(frame, BENCH_FRAME);
+        }
+        day_start += 24 * 3600;
+    }
+
+    /* Collect what the model counted. */
+    result.stats = rack_twin_get_stats(t);
+    rack_term(&r);
+    rack_twin_term(&t);
+    remove(BENCH_JOURNAL);
+    remove(BENCH_LIGHT_MAP);
+
+    return result;
+}
+
+/**
+ * This function prints the results provided to it, one line each, with a
+ * header line naming the columns.
+ */
+void bench_print(bench_result* results, int num_results, FILE* fs)
+{
+    int i;
+
+    fprintf(fs, "%-18s %8s %10s %10s %10s %10s %8s %9s %9s %9s\n",
+            "strategy", "searches", "search_s", "motor_s", "x_steps",
+            "z_steps", "lost", "readings", "aim_deg", "worst_deg");
+    for (i = 0; i < num_results; i++)
+    {
+        fprintf(fs, "%-18s %8d %10.1f %10.1f %10ld %10ld %8ld %9d %9.2f"
+                    " %9.2f\n",
+                results[i].name, results[i].searches,
+                results[i].search_time, results[i].stats.motor_time,
+                results[i].stats.x_steps, results[i].stats.z_steps,
+                results[i].stats.lost_steps, results[i].stats.readings,
+                results[i].aim_checks > 0
+                    ? results[i].aim_sum / results[i].aim_checks : 0,
+                results[i].worst_aim);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bench_result results[NUM_STRATEGIES];   /* The results of every way. */
+    rack_twin_config config;                /* The model's set up. */
+    int days;                               /* The days to simulate. */
+    int s;
+
+    /* Read the number of days, and the seed of the clouds and noise. */
+    config = RACK_TWIN_DEFAULT_CONFIG;
+    days = argc > 1 ? atoi(argv[1]) : BENCH_DAYS;
+    if (argc > 2)
+        config.seed = atoi(argv[2]);
+
+    /* Run on the simulated pins, as fast as the virtual clock allows. */
+    gpio_select(gpio_sim_backend());
+    gpio_setup();
+    use_clock(VIRTUAL_CLOCK);
+
+    /* Benchmark every way of pointing at the light on the same days. */
+    for (s = 0; s < NUM_STRATEGIES; s++)
+    {
+        fprintf(stderr, " - Benchmarking %d days of %s...\n",
+                days, strategy_names[s]);
+        results[s] = bench_run(s, days, config);
+    }
+
+    bench_print(results, NUM_STRATEGIES, stdout);
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,412 @@
+/**
+ * rack_tune.c
+ *
+ * This file contains the main function for the rack tuner. It runs
+ * thousands of simulated light searches, under randomised suns, clouds and
+ * sensor noise, for randomly chosen layouts of the search positions and
+ * step rates, and prints the choices that no other choice beats on both
+ * search time and aim error.
+ *
+ * The simulated pins and the virtual clock belong to the whole program, so
+ * the searches are spread over one worker process for every core rather
+ * than over threads. The workers only share the number of the next
+ * candidate, and every search starts the virtual clock from the same
+ * time, so the results are the same whatever the number of workers.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "rack.h"
+#include "rack_twin.h"
+#include "gpio.h"
+#include "gpio_sim.h"
+#include "mycutils.h"
+
+/* These are the files every worker's rack keeps its journal and light map
+ * in. They are numbered by the worker's process id. */
+#define TUNE_JOURNAL "../../tune_%d.journal"
+#define TUNE_LIGHT_MAP "../../tune_%d_light_map.bin"
+
+/* This is midnight UTC on the 1st of January 2024. The trials are spread
+ * across the year from it. */
+#define TUNE_YEAR 1704067200
+
+/* These are the solar hours the trials are spread between. */
+#define TUNE_FIRST_HOUR 8
+#define TUNE_LAST_HOUR 16
+
+/* These are the most cloudiness and noise a trial has. */
+#define TUNE_MAX_CLOUDINESS 0.5
+#define TUNE_MAX_NOISE 0.05
+
+/* These are the ranges the choices are picked from. */
+#define TUNE_MAX_COLUMNS 5
+#define TUNE_MAX_ROWS 7
+#define TUNE_MIN_STEP_RATE 100
+#define TUNE_MAX_STEP_RATE 1200
+#define TUNE_STEP_RATE_STEP 50
+
+/* These are the number of choices, and the trials every choice is run
+ * against, if none are given. */
+#define TUNE_CANDIDATES 200
+#define TUNE_TRIALS 20
+
+/* This is the time, in nano-seconds, between the rack's updates. */
+#define TUNE_FRAME (NANOS_PER_SEC / 2)
+
+/* This is the longest time, in nano-seconds, a search is given. */
+#define TUNE_TIMEOUT (2ULL * NANOS_PER_HOUR)
+
+/* This is the time, in nano-seconds, the virtual clock is at when every
+ * search starts, so no search depends on the ones before it. */
+#define TUNE_CLOCK_START (1000ULL * NANOS_PER_SEC)
+
+/**
+ * These are the choices the tuner makes about how the rack searches.
+ */
+typedef struct {
+    int num_x;                  /* The columns of positions. */
+    int num_z;                  /* The rows of positions. */
+    enum SearchLayout layout;   /* How the positions are laid out. */
+    unsigned int step_rate;     /* The rate the motors step at. */
+} tune_params;
+
+/**
+ * This is how well one choice did across every trial.
+ */
+typedef struct {
+    int candidate;          /* The number of the choice. */
+    double search_time;     /* The mean seconds a search took. */
+    double aim_error;       /* The mean degrees from the sun it ended. */
+    double worst_aim;       /* The worst degrees from the sun it ended. */
+    long lost_steps;        /* The steps lost across every trial. */
+} tune_result;
+
+/**
+ * This function returns a random number from 0 up to 1.
+ */
+double tune_random(unsigned int* seed)
+{
+    return (double) rand_r(seed) / ((double) RAND_MAX + 1);
+}
+
+/**
+ * This function picks the choices of the candidate provided to it. The
+ * first candidate is always the rack's own choices, so the others can be
+ * compared to it.
+ */
+tune_params tune_pick(int candidate, unsigned int seed)
+{
+    tune_params p;  /* The choices. */
+
+    if (candidate == 0)
+        return (tune_params) { 3, 3, EDGES_LAYOUT, RACK_STEPS_PER_SEC };
+
+    seed = seed * 7919 + candidate;
+    p.num_x = 2 + (int) (tune_random(&seed) * (TUNE_MAX_COLUMNS - 1));
+    p.num_z = 2 + (int) (tune_random(&seed) * (TUNE_MAX_ROWS - 1));
+    p.layout = tune_random(&seed) < 0.5 ? EDGES_LAYOUT : GRID_LAYOUT;
+    p.step_rate = TUNE_MIN_STEP_RATE + TUNE_STEP_RATE_STEP
+        * (int) (tune_random(&seed) * ((TUNE_MAX_STEP_RATE
+                 - TUNE_MIN_STEP_RATE) / TUNE_STEP_RATE_STEP + 1));
+    return p;
+}
+
+/**
+ * This function sets up the sky of the trial provided to it, and stores
+ * the time the trial starts at in when. Every candidate gets the same
+ * trials, so they are compared fairly.
+ */
+rack_twin_config tune_trial(int trial, unsigned int seed, time_t* when)
+{
+    rack_twin_config config;    /* The sky of the trial. */
+    double hour;                /* The solar time of the trial. */
+    int day;                    /* The day of the year of the trial. */
+
+    config = RACK_TWIN_DEFAULT_CONFIG;
+    seed = seed * 104729 + trial;
+    day = (int) (tune_random(&seed) * 365);
+    hour = TUNE_FIRST_HOUR
+        + tune_random(&seed) * (TUNE_LAST_HOUR - TUNE_FIRST_HOUR);
+    config.heading = tune_random(&seed) * 360;
+    config.cloudiness = tune_random(&seed) * TUNE_MAX_CLOUDINESS;
+    config.noise = tune_random(&seed) * TUNE_MAX_NOISE;
+    config.seed = rand_r(&seed);
+
+    *when = TUNE_YEAR + day * 24 * 3600
+        + (time_t) ((hour - config.longitude / 15) * 3600);
+    return config;
+}
+
+/**
+ * This function runs one light search with the choices provided to it,
+ * under the sky provided to it. It returns the seconds the search took,
+ * storing the degrees from the sun it ended in aim and the steps that
+ * were lost in lost_steps.
+ */
+double tune_search(tune_params p, rack_twin_config config, time_t when,
+                   char* journal_file, char* light_map_file,
+                   double* aim, long* lost_steps)
+{
+    struct timespec start;      /* When the search started. */
+    struct timespec frame;      /* The start of the current update. */
+    struct timespec end;        /* When the search finished. */
+    rack_twin t;                /* The model of the rack and the sky. */
+    rack r;                     /* The rack. */
+    int position, num_positions;
+
+    /* Start with a rack that knows nothing, pointing straight up, at the
+     * same time on the virtual clock as every other search. */
+    reset_virtual_clock(TUNE_CLOCK_START);
+    remove(journal_file);
+    remove(light_map_file);
+    rack_twin_init(&t, config);
+    rack_init_files(&r, journal_file, light_map_file);
+    rack_set_journal_interval(&r, TUNE_TIMEOUT);
+    rack_set_search_mode(&r, FULL_SEARCH, SEARCH_CONFIDENCE);
+    rack_set_search_grid(&r, p.num_x, p.num_z, p.layout);
+    rack_set_step_rate(&r, p.step_rate);
+    rack_set_frame_time(&r, TUNE_FRAME);
+
+    /* Search, updating the rack every frame until it is done. */
+    set_wall_time(when);
+    rack_twin_new_series(&t);
+    get_time(&start);
+    rack_update(&r, LIGHT_SEARCH);
+    while (rack_get_search_stage(r, &position, &num_positions) != SEARCH_IDLE
+           && !check_timer(start, TUNE_TIMEOUT))
+    {
+        start_timer(&frame);
+        wait_timer(frame, TUNE_FRAME);
+        rack_update(&r, NO_RACK_COMMAND);
+    }
+    get_time(&end);
+
+    /* Check how it did. A search that ends after sunset missed the sun
+     * altogether. */
+    *aim = rack_twin_aim_error(t);
+    if (*aim < 0)
+        *aim = 180;
+    *lost_steps = rack_twin_get_stats(t).lost_steps;
+    rack_term(&r);
+    rack_twin_term(&t);
+    remove(journal_file);
+    remove(light_map_file);
+
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/**
+ * This function is run by every worker process. It takes the next
+ * candidate from the counter the workers share until there are none left,
+ * runs every trial for it, and writes how it did to the file descriptor
+ * provided to it.
+ */
+void tune_work(_Atomic int* next, int num_candidates, int num_trials,
+               unsigned int seed, int fd)
+{
+    char* journal_file;         /* The worker's journal. */
+    char* light_map_file;       /* The worker's light map. */
+    rack_twin_config config;    /* The sky of a trial. */
+    tune_params p;              /* The choices being tried. */
+    tune_result result;         /* How they did. */
+    time_t when;                /* When a trial starts. */
+    double aim;                 /* How far from the sun a search ended. */
+    long lost;                  /* The steps a search lost. */
+    int c, trial;
+
+    /* The searches print as they go, which nobody is reading. */
+    freopen("/dev/null", "w", stdout);
+
+    /* Run on the worker's own simulated pins and virtual clock. */
+    gpio_select(gpio_sim_backend());
+    gpio_setup();
+    use_clock(VIRTUAL_CLOCK);
+    strfmt(&journal_file, TUNE_JOURNAL, getpid());
+    strfmt(&light_map_file, TUNE_LIGHT_MAP, getpid());
+
+    while ((c = atomic_fetch_add(next, 1)) < num_candidates)
+    {
+        p = tune_pick(c, seed);
+        result = (tune_result) { c, 0, 0, 0, 0 };
+        for (trial = 0; trial < num_trials; trial++)
+        {
+            config = tune_trial(trial, seed, &when);
+            result.search_time += tune_search(p, config, when, journal_file,
+                                              light_map_file, &aim, &lost);
+            result.aim_error += aim;
+            if (aim > result.worst_aim)
+                result.worst_aim = aim;
+            result.lost_steps += lost;
+        }
+        result.search_time /= num_trials;
+        result.aim_error /= num_trials;
+
+        /* The result is smaller than a pipe's atomic write, so the workers
+         * can share one pipe. */
+        write(fd, &result, sizeof(result));
+    }
+
+    free(journal_file);
+    free(light_map_file);
+}
+
+/**
+ * This function returns true if the first result provided to it is no
+ * worse than the second on both search time and aim error, and better on
+ * one of them.
+ */
+bool tune_dominates(tune_result a, tune_result b)
+{
+    return a.search_time <= b.search_time && a.aim_error <= b.aim_error
+        && (a.search_time < b.search_time || a.aim_error < b.aim_error);
+}
+
+/**
+ * This function compares two results by search time, then aim error, then
+ * candidate, for qsort(). The results arrive in whatever order the workers
+ * finish them, so ties have to be broken the same way every time.
+ */
+int tune_compare_time(const void* a, const void* b)
+{
+    tune_result* ra = (tune_result*) a;     /* The first result. */
+    tune_result* rb = (tune_result*) b;     /* The second result. */
+
+    if (ra->search_time != rb->search_time)
+        return ra->search_time > rb->search_time ? 1 : -1;
+    if (ra->aim_error != rb->aim_error)
+        return ra->aim_error > rb->aim_error ? 1 : -1;
+    return ra->candidate - rb->candidate;
+}
+
+/**
+ * This function prints one result, and the choices it was for.
+ */
+void tune_print_result(tune_result r, unsigned int seed, FILE* fs)
+{
+    tune_params p = tune_pick(r.candidate, seed);
+
+    fprintf(fs, "%9d %6d %6d %-6s %9u %10.1f %9.2f %9.2f %8ld\n",
+            r.candidate, p.num_x, p.num_z,
+            p.layout == EDGES_LAYOUT ? "edges" : "grid", p.step_rate,
+            r.search_time, r.aim_error, r.worst_aim, r.lost_steps);
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t start;             /* When the tuning started. */
+    tune_result* results;       /* How every candidate did. */
+    unsigned int seed;          /* Seeds the choices and the trials. */
+    double seconds;             /* How long the tuning took. */
+    int num_candidates;         /* The number of choices to try. */
+    int num_trials;             /* The number of trials for each. */
+    int num_workers;            /* The number of worker processes. */
+    int fds[2];                 /* The pipe the workers write to. */
+    _Atomic int* next;          /* The next candidate, shared by the
+                                 * workers. */
+    char* tstamp;               /* The time of an error. */
+    int i, j, num_front;
+
+    /* Read the number of candidates, trials, workers, and the seed. */
+    num_candidates = argc > 1 ? atoi(argv[1]) : TUNE_CANDIDATES;
+    num_trials = argc > 2 ? atoi(argv[2]) : TUNE_TRIALS;
+    num_workers = argc > 3 ? atoi(argv[3]) : sysconf(_SC_NPROCESSORS_ONLN);
+    seed = argc > 4 ? atoi(argv[4]) : 1;
+    if (num_candidates < 1 || num_trials < 1 || num_workers < 1)
+    {
+        fprintf(stderr,
+                "usage: %s [candidates] [trials] [workers] [seed]\n",
+                argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (num_workers > num_candidates)
+        num_workers = num_candidates;
+
+    /* Start the workers, which take the candidates one at a time from a
+     * counter they share. */
+    fprintf(stderr, " - Running %d trials of %d candidates on %d workers...\n",
+            num_trials, num_candidates, num_workers);
+    start = monotonic_nanos();
+    fflush(NULL);
+    next = (_Atomic int*) mmap(NULL, sizeof(_Atomic int),
+                               PROT_READ | PROT_WRITE,
+                               MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (next == MAP_FAILED)
+    {
+        fprintf(stderr, "[ %s ] ERROR: In function main(): "
+                        "Could not share the candidate counter\n",
+                (tstamp = timestamp()));
+        free(tstamp);
+        exit(EXIT_FAILURE);
+    }
+    atomic_init(next, 0);
+    pipe(fds);
+    for (i = 0; i < num_workers; i++)
+    {
+        if (fork() == 0)
+        {
+            close(fds[0]);
+            tune_work(next, num_candidates, num_trials, seed, fds[1]);
+            close(fds[1]);
+            exit(EXIT_SUCCESS);
+        }
+    }
+    close(fds[1]);
+
+    /* Collect the results as the workers finish them. */
+    results = (tune_result*) malloc(sizeof(tune_result) * num_candidates);
+    for (i = 0; i < num_candidates
+                && read(fds[0], &results[i], sizeof(tune_result))
+                   == sizeof(tune_result); i++);
+    close(fds[0]);
+    while (wait(NULL) > 0);
+    munmap(next, sizeof(_Atomic int));
+    seconds = (monotonic_nanos() - start) / 1e9;
+    if (i < num_candidates)
+    {
+        fprintf(stderr, "[ %s ] ERROR: In function main(): "
+                        "only %d of %d candidates finished\n",
+                (tstamp = timestamp()), i, num_candidates);
+        free(tstamp);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(stderr, " - Ran %d searches in %.2f seconds, %.0f a second\n",
+            num_candidates * num_trials, seconds,
+            num_candidates * num_trials / seconds);
+
+    /* Keep only the candidates no other candidate beats. */
+    qsort(results, num_candidates, sizeof(tune_result), tune_compare_time);
+    printf("%9s %6s %6s %-6s %9s %10s %9s %9s %8s\n",
+           "candidate", "num_x", "num_z", "layout", "step_rate",
+           "search_s", "aim_deg", "worst_deg", "lost");
+    num_front = 0;
+    for (i = 0; i < num_candidates; i++)
+    {
+        for (j = 0; j < num_candidates; j++)
+            if (tune_dominates(results[j], results[i]))
+                break;
+        if (j == num_candidates)
+        {
+            tune_print_result(results[i], seed, stdout);
+            num_front++;
+        }
+    }
+
+    /* Show how the rack's own choices did. */
+    for (i = 0; i < num_candidates && results[i].candidate != 0; i++);
+    printf("# %d of %d candidates are on the Pareto front. "
+           "The rack's own choices did:\n", num_front, num_candidates);
+    printf("# ");
+    tune_print_result(results[i], seed, stdout);
+
+    free(results);
+    exit(EXIT_SUCCESS);
+}
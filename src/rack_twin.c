@@ -0,0 +1,465 @@
+/**
+ * rack_twin.c
+ *
+ * This file contains the internal data-structure and function definitions
+ * for the rack_twin type.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#include "rack_twin.h"
+
+/**
+ * This is the model of one of the rack's axes and the stepper motor that
+ * turns it.
+ */
+typedef struct {
+    int pins[4];                /* The pins of the motor's coils. */
+    int levels[4];              /* The levels the pins were last set to. */
+    int phase;                  /* The phase the coils are in, or -1. */
+    long steps;                 /* Where the axis really is, in steps. */
+    long min_steps;             /* The furthest it can go one way. */
+    long max_steps;             /* The furthest it can go the other way. */
+    long taken;                 /* The steps it has taken. */
+    bool has_stepped;           /* Whether it has taken a step yet. */
+    struct timespec last_step;  /* When it last took a step. */
+} twin_axis;
+
+/**
+ * This is the internal data-structure of the rack_twin type.
+ */
+struct rack_twin_data {
+    rack_twin_config config;    /* How the model is set up. */
+    twin_axis x;                /* The x axis. */
+    twin_axis z;                /* The z axis. */
+    int ldr_pins[3];            /* The pins of the arduino. */
+    int switch_pin;             /* The pin of the limit switch. */
+    long switch_steps;          /* Where the limit switch is pressed. */
+    bool requested;             /* Whether a reading has been asked for. */
+    struct timespec request_time;   /* When it was asked for. */
+    bool brightest;             /* Whether the last reading was the
+                                 * brightest of its series. */
+    double series_best;         /* The brightest reading of the series. */
+    double cloud_phases[RACK_TWIN_CLOUD_WAVES]; /* Where the waves that
+                                                 * make up the clouds
+                                                 * start. */
+    unsigned int seed;          /* The state of the random numbers. */
+    long lost_steps;            /* The steps that were lost. */
+    double motor_time;          /* The seconds the motors spent moving. */
+    int readings;               /* The readings that were made. */
+};
+
+/**
+ * This is one of the four phases of a stepper motor's coils, in the order
+ * step_motor() switches them.
+ */
+const int twin_phases[4][4] = {
+    { HIGH, HIGH, LOW, LOW },
+    { LOW, HIGH, HIGH, LOW },
+    { LOW, LOW, HIGH, HIGH },
+    { HIGH, LOW, LOW, HIGH }
+};
+
+/**
+ * This function converts an angle in degrees to a step position using the
+ * fixed-point number of steps per degree provided to it.
+ */
+long twin_degrees_to_steps(double degrees, int64_t steps_per_degree)
+{
+    return lround(degrees * steps_per_degree / STEPS_ONE);
+}
+
+/**
+ * This function converts a step position to an angle in degrees using the
+ * fixed-point number of steps per degree provided to it.
+ */
+double twin_steps_to_degrees(long steps, int64_t steps_per_degree)
+{
+    return (double) steps * STEPS_ONE / steps_per_degree;
+}
+
+/**
+ * This function returns a random number with a mean of zero and a spread
+ * of one.
+ */
+double twin_gaussian(rack_twin t)
+{
+    double u1, u2;  /* Uniform random numbers. */
+
+    u1 = (rand_r(&t->seed) + 1.0) / ((double) RAND_MAX + 2.0);
+    u2 = (rand_r(&t->seed) + 1.0) / ((double) RAND_MAX + 2.0);
+    return sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+/**
+ * This function sets up the model of an axis.
+ */
+void twin_axis_init(twin_axis* a, const int pins[4], double start,
+                    double travel, int64_t steps_per_degree)
+{
+    int p;
+
+    for (p = 0; p < 4; p++)
+    {
+        a->pins[p] = pins[p];
+        a->levels[p] = LOW;
+    }
+    a->phase = -1;
+    a->steps = twin_degrees_to_steps(start, steps_per_degree);
+    a->min_steps = twin_degrees_to_steps(-travel, steps_per_degree);
+    a->max_steps = twin_degrees_to_steps(travel, steps_per_degree);
+    a->taken = 0;
+    a->has_stepped = false;
+}
+
+/**
+ * This function tells the model of an axis that one of the pins provided
+ * to it was set to the value also provided, moving the axis if its coils
+ * are now in the next or previous phase. It returns true if the pin
+ * belongs to the axis.
+ */
+bool twin_axis_output(rack_twin t, twin_axis* a, int pin, int value)
+{
+    struct timespec now;    /* When the step was taken. */
+    uint64_t gap;           /* The time since the last step. */
+    int p, phase, step;
+
+    /* Find which coil the pin switches. */
+    for (p = 0; p < 4 && a->pins[p] != pin; p++);
+    if (p == 4)
+        return false;
+    a->levels[p] = value;
+
+    /* The coils are switched one at a time, so only whole phases count. */
+    for (phase = 0; phase < 4; phase++)
+        if (memcmp(a->levels, twin_phases[phase], sizeof(a->levels)) == 0)
+            break;
+    if (phase == 4 || phase == a->phase)
+        return true;
+
+    /* The first phase only energises the motor. */
+    if (a->phase == -1)
+    {
+        a->phase = phase;
+        return true;
+    }
+
+    /* The next phase turns the motor one way and the previous one the
+     * other. Skipping a phase leaves the rotor unsure which way to go. */
+    step = (phase - a->phase + 4) % 4;
+    a->phase = phase;
+    if (step == 2)
+    {
+        t->lost_steps++;
+        return true;
+    }
+    step = step == 1 ? 1 : -1;
+
+    /* Work out how long it has been since the last step. */
+    get_time(&now);
+    gap = RACK_TWIN_STEP_GAP + 1;
+    if (a->has_stepped)
+        gap = (uint64_t) (now.tv_sec - a->last_step.tv_sec) * NANOS_PER_SEC
+            + now.tv_nsec - a->last_step.tv_nsec;
+    a->last_step = now;
+    a->has_stepped = true;
+
+    /* The axis can't go past where it hits something, and the motor
+     * stalls if it is stepped too quickly. */
+    if (a->steps + step < a->min_steps || a->steps + step > a->max_steps
+        || gap < NANOS_PER_SEC / RACK_TWIN_MAX_STEP_RATE)
+    {
+        t->lost_steps++;
+        return true;
+    }
+    a->steps += step;
+    a->taken++;
+
+    /* Count the time the motor spent turning, leaving out the pauses
+     * between moves. */
+    if (gap <= RACK_TWIN_STEP_GAP)
+        t->motor_time += (double) gap / NANOS_PER_SEC;
+
+    return true;
+}
+
+/**
+ * This function stores the direction of the sun at the time provided to
+ * it in sun, as east, north and up.
+ */
+void twin_sun_direction(rack_twin t, time_t when, double sun[3])
+{
+    struct tm utc;          /* The time in UTC. */
+    double declination;     /* How far north of the equator the sun is. */
+    double hour_angle;      /* How far west of noon the sun is. */
+    double latitude;        /* Where the rover is. */
+    double hours;           /* The solar time of day. */
+
+    gmtime_r(&when, &utc);
+    declination = -23.44 * M_PI / 180
+        * cos(2 * M_PI / 365 * (utc.tm_yday + 10));
+    hours = utc.tm_hour + utc.tm_min / 60.0 + utc.tm_sec / 3600.0
+        + t->config.longitude / 15;
+    hour_angle = (hours - 12) * 15 * M_PI / 180;
+    latitude = t->config.latitude * M_PI / 180;
+
+    sun[0] = -cos(declination) * sin(hour_angle);
+    sun[1] = sin(declination) * cos(latitude)
+        - cos(declination) * cos(hour_angle) * sin(latitude);
+    sun[2] = sin(declination) * sin(latitude)
+        + cos(declination) * cos(hour_angle) * cos(latitude);
+}
+
+/**
+ * This function stores the direction the solar panels of the rack_twin
+ * provided to it are pointing in normal, as east, north and up. The z axis
+ * rolls the panels towards the rover's right and the x axis then pitches
+ * them towards its front.
+ */
+void twin_panel_direction(rack_twin t, double normal[3])
+{
+    double x, z;            /* The angles of the axes, in radians. */
+    double heading;         /* The way the rover faces, in radians. */
+    double front, right;    /* The parts of the direction along the rover's
+                             * front and right. */
+
+    x = twin_steps_to_degrees(t->x.steps, STEPS_PER_DEGREE_X) * M_PI / 180;
+    z = twin_steps_to_degrees(t->z.steps, STEPS_PER_DEGREE_Z) * M_PI / 180;
+    heading = t->config.heading * M_PI / 180;
+
+    front = sin(x) * cos(z);
+    right = sin(z);
+    normal[0] = front * sin(heading) + right * cos(heading);
+    normal[1] = front * cos(heading) - right * sin(heading);
+    normal[2] = cos(x) * cos(z);
+}
+
+/**
+ * This function returns how much of the sun gets through the clouds at the
+ * time provided to it.
+ */
+double twin_cloud_transmission(rack_twin t, time_t when)
+{
+    double cover = 0;   /* How much of the sky is covered, from 0 to 1. */
+    int w;
+
+    /* The clouds are a few slow waves of different lengths added up. */
+    for (w = 0; w < RACK_TWIN_CLOUD_WAVES; w++)
+    {
+        cover += (1 + sin(2 * M_PI * when
+                          / (RACK_TWIN_CLOUD_PERIOD * (w * 2 + 1))
+                          + t->cloud_phases[w])) / 2;
+    }
+    return 1 - t->config.cloudiness * cover / RACK_TWIN_CLOUD_WAVES;
+}
+
+/**
+ * This function returns the reading the light dependant resistor of the
+ * rack_twin provided to it makes where the panels are pointing, as a
+ * fraction of full sun.
+ */
+double twin_light_reading(rack_twin t)
+{
+    double sun[3];      /* The direction of the sun. */
+    double normal[3];   /* The direction the panels point in. */
+    double direct;      /* How square on the panels are to the sun. */
+    time_t now;         /* The time of the reading. */
+
+    now = wall_time();
+    twin_sun_direction(t, now, sun);
+    twin_panel_direction(t, normal);
+
+    /* The sun only lights the panels while it is up and in front of
+     * them, and the sky lights them more the more they face up. */
+    direct = sun[0] * normal[0] + sun[1] * normal[1] + sun[2] * normal[2];
+    if (direct < 0 || sun[2] < 0)
+        direct = 0;
+    return direct * twin_cloud_transmission(t, now)
+        + RACK_TWIN_DIFFUSE * (1 + normal[2]) / 2
+        + t->config.noise * twin_gaussian(t);
+}
+
+/**
+ * This function is told by the simulated gpio pins about every output.
+ */
+void twin_on_output(int pin, int value, void* arg)
+{
+    rack_twin t = (rack_twin) arg;  /* The model. */
+    double reading;                 /* The reading that was asked for. */
+
+    /* Move the axes. */
+    if (twin_axis_output(t, &t->x, pin, value)
+        || twin_axis_output(t, &t->z, pin, value))
+        return;
+
+    /* The arduino makes a reading when it is asked for one, where the
+     * panels are pointing when it is asked. */
+    if (pin == t->ldr_pins[0])
+    {
+        if (value == HIGH && !t->requested)
+        {
+            reading = twin_light_reading(t);
+            t->brightest = reading > t->series_best;
+            if (t->brightest)
+                t->series_best = reading;
+            t->readings++;
+            get_time(&t->request_time);
+        }
+        t->requested = value == HIGH;
+    }
+}
+
+/**
+ * This function is asked by the simulated gpio pins about every input. It
+ * returns the level of the pin, or -1 if the model doesn't have the pin.
+ */
+int twin_on_input(int pin, void* arg)
+{
+    rack_twin t = (rack_twin) arg;  /* The model. */
+    struct timespec now;            /* When the pin is read. */
+    uint64_t elapsed;               /* The time since the reading was
+                                     * asked for. */
+
+    /* The limit switch pulls its pin low while it is pressed. */
+    if (pin == t->switch_pin)
+        return t->z.steps <= t->switch_steps ? LOW : HIGH;
+
+    /* The arduino says it is ready once it has had time to make the
+     * reading. The pins are locked while this is asked, so it never waits
+     * for the reading itself. */
+    if (pin == t->ldr_pins[1])
+    {
+        if (!t->requested)
+            return LOW;
+        get_time(&now);
+        elapsed = (uint64_t) (now.tv_sec - t->request_time.tv_sec)
+                * NANOS_PER_SEC + now.tv_nsec - t->request_time.tv_nsec;
+        return elapsed >= RACK_TWIN_READING_TIME ? HIGH : LOW;
+    }
+
+    /* The arduino says whether the reading was the brightest. */
+    if (pin == t->ldr_pins[2])
+        return t->brightest ? HIGH : LOW;
+
+    return -1;
+}
+
+/**
+ * This function initialises the rack_twin provided to it and connects it
+ * to the simulated gpio pins.
+ */
+void rack_twin_init(rack_twin* tp, rack_twin_config config)
+{
+    const int zpins[4] = { RACK_ZMOTOR_PINS };  /* The z motor's pins. */
+    const int xpins[4] = { RACK_XMOTOR_PINS };  /* The x motor's pins. */
+    const int ldr_pins[3] = { RACK_LDR_PINS };  /* The arduino's pins. */
+    int w;
+
+    /* Allocate memory. */
+    *tp = (rack_twin) malloc(sizeof(struct rack_twin_data));
+
+    /* Set up the axes. */
+    (*tp)->config = config;
+    twin_axis_init(&(*tp)->x, xpins, config.start_x, RACK_TWIN_X_TRAVEL,
+                   STEPS_PER_DEGREE_X);
+    twin_axis_init(&(*tp)->z, zpins, config.start_z, RACK_TWIN_Z_TRAVEL,
+                   STEPS_PER_DEGREE_Z);
+    (*tp)->switch_pin = RACK_LIMIT_SWITCH_PIN;
+    (*tp)->switch_steps = twin_degrees_to_steps(RACK_TWIN_SWITCH_ANGLE,
+                                                STEPS_PER_DEGREE_Z);
+
+    /* Set up the arduino. */
+    memcpy((*tp)->ldr_pins, ldr_pins, sizeof(ldr_pins));
+    (*tp)->requested = false;
+    (*tp)->brightest = false;
+    (*tp)->series_best = -INFINITY;
+
+    /* Set up the sky. */
+    (*tp)->seed = config.seed;
+    for (w = 0; w < RACK_TWIN_CLOUD_WAVES; w++)
+        (*tp)->cloud_phases[w] = 2 * M_PI * rand_r(&(*tp)->seed) / RAND_MAX;
+
+    rack_twin_reset_stats(tp);
+
+    /* Connect to the pins. */
+    gpio_sim_set_model(twin_on_output, twin_on_input, *tp);
+}
+
+/**
+ * This function disconnects the rack_twin provided to it from the simulated
+ * gpio pins and terminates it.
+ */
+void rack_twin_term(rack_twin* tp)
+{
+    /* Disconnect from the pins. */
+    gpio_sim_set_model(NULL, NULL, NULL);
+
+    /* De-allocate memory. */
+    free(*tp);
+}
+
+/**
+ * This function makes the arduino of the rack_twin provided to it start a
+ * new series of readings, as it does at the start of every light search.
+ */
+void rack_twin_new_series(rack_twin* tp)
+{
+    (*tp)->series_best = -INFINITY;
+}
+
+/**
+ * This function returns the totals the rack_twin provided to it has kept.
+ */
+rack_twin_stats rack_twin_get_stats(rack_twin t)
+{
+    return (rack_twin_stats) {
+        .x_steps = t->x.taken,
+        .z_steps = t->z.taken,
+        .lost_steps = t->lost_steps,
+        .motor_time = t->motor_time,
+        .readings = t->readings
+    };
+}
+
+/**
+ * This function sets the totals the rack_twin provided to it keeps back to
+ * zero.
+ */
+void rack_twin_reset_stats(rack_twin* tp)
+{
+    (*tp)->x.taken = 0;
+    (*tp)->z.taken = 0;
+    (*tp)->lost_steps = 0;
+    (*tp)->motor_time = 0;
+    (*tp)->readings = 0;
+}
+
+/**
+ * This function returns the angle, in degrees, between where the solar
+ * panels of the rack_twin provided to it are pointing and the sun, or a
+ * negative number if the sun has set.
+ */
+double rack_twin_aim_error(rack_twin t)
+{
+    double sun[3];      /* The direction of the sun. */
+    double normal[3];   /* The direction the panels point in. */
+    double cosine;      /* The cosine of the angle between them. */
+
+    twin_sun_direction(t, wall_time(), sun);
+    if (sun[2] < 0)
+        return -1;
+    twin_panel_direction(t, normal);
+    cosine = sun[0] * normal[0] + sun[1] * normal[1] + sun[2] * normal[2];
+    return acos(fmax(-1, fmin(1, cosine))) * 180 / M_PI;
+}
+
+/**
+ * This function stores where the axes of the rack_twin provided to it
+ * really are, in degrees.
+ */
+void rack_twin_get_angles(rack_twin t, double* x, double* z)
+{
+    *x = twin_steps_to_degrees(t->x.steps, STEPS_PER_DEGREE_X);
+    *z = twin_steps_to_degrees(t->z.steps, STEPS_PER_DEGREE_Z);
+}
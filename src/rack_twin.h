@@ -0,0 +1,141 @@
+/**
+ * rack_twin.h
+ *
+ * This file contains the public data-structure and function prototype
+ * declarations for the rack_twin type.
+ *
+ * The rack_twin type is a model of the rack and the sky above it that runs
+ * behind the simulated gpio pins. It moves the axes as the stepper motors'
+ * coils are switched, presses the limit switch, and answers the rack's
+ * requests for readings the way the arduino would, from the sun, the
+ * clouds and where the solar panels are pointing.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#ifndef rack_twin_h
+#define rack_twin_h
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <math.h>
+
+#include "gpio_sim.h"
+#include "rack.h"
+#include "mycutils.h"
+
+/* These are the furthest, in degrees, the axes can physically rotate
+ * either way from the middle before they hit something. */
+#define RACK_TWIN_X_TRAVEL 30
+#define RACK_TWIN_Z_TRAVEL 95
+
+/* This is the angle, in degrees, the limit switch is pressed at. */
+#define RACK_TWIN_SWITCH_ANGLE -90
+
+/* This is the time, in nano-seconds, the arduino takes to make a
+ * reading. */
+#define RACK_TWIN_READING_TIME 20000000
+
+/* This is the fastest rate, in steps per second, the motors can turn the
+ * rack at. Steps that come any faster are lost as the motor stalls. */
+#define RACK_TWIN_MAX_STEP_RATE 1000
+
+/* This is the longest time, in nano-seconds, between two steps of a motor
+ * for it to count as still moving. */
+#define RACK_TWIN_STEP_GAP 50000000
+
+/* This is how bright the sky is compared to the sun, lighting the panels
+ * from every direction. */
+#define RACK_TWIN_DIFFUSE 0.1
+
+/* This is the number of waves that make up the clouds, and the period, in
+ * seconds, of the first of them. */
+#define RACK_TWIN_CLOUD_WAVES 3
+#define RACK_TWIN_CLOUD_PERIOD 420
+
+/**
+ * This is how the model of the rack and the sky is set up.
+ */
+typedef struct {
+    double latitude;    /* Where the rover is, in degrees north. */
+    double longitude;   /* Where the rover is, in degrees east. */
+    double heading;     /* The way the rover faces, in degrees clockwise
+                         * from north. */
+    double cloudiness;  /* How much the clouds dim the sun, from 0 to 1. */
+    double noise;       /* The spread of the arduino's readings, as a
+                         * fraction of full sun. */
+    double start_x;     /* Where the x axis really is to begin with, in
+                         * degrees. */
+    double start_z;     /* Where the z axis really is to begin with, in
+                         * degrees. */
+    unsigned int seed;  /* Seeds the clouds and the noise. */
+} rack_twin_config;
+
+/* This is a rover facing north in southern Australia on a day with a few
+ * clouds. */
+#define RACK_TWIN_DEFAULT_CONFIG \
+    ((rack_twin_config) { -35, 138.6, 0, 0.3, 0.02, 0, 0, 1 })
+
+/**
+ * These are the totals the model keeps of what the rack has done.
+ */
+typedef struct {
+    long x_steps;       /* The steps the x axis has taken. */
+    long z_steps;       /* The steps the z axis has taken. */
+    long lost_steps;    /* The steps that were blocked or couldn't be
+                         * followed. */
+    double motor_time;  /* The seconds the motors have spent moving. */
+    int readings;       /* The readings the arduino has made. */
+} rack_twin_stats;
+
+/**
+ * This is the data-structure of the rack_twin type.
+ */
+typedef struct rack_twin_data* rack_twin;
+
+/**
+ * This function initialises the rack_twin provided to it and connects it
+ * to the simulated gpio pins.
+ */
+void rack_twin_init(rack_twin* tp, rack_twin_config config);
+
+/**
+ * This function disconnects the rack_twin provided to it from the simulated
+ * gpio pins and terminates it.
+ */
+void rack_twin_term(rack_twin* tp);
+
+/**
+ * This function makes the arduino of the rack_twin provided to it start a
+ * new series of readings, as it does at the start of every light search.
+ * The model can't tell when a search starts, so it has to be told.
+ */
+void rack_twin_new_series(rack_twin* tp);
+
+/**
+ * This function returns the totals the rack_twin provided to it has kept.
+ */
+rack_twin_stats rack_twin_get_stats(rack_twin t);
+
+/**
+ * This function sets the totals the rack_twin provided to it keeps back to
+ * zero.
+ */
+void rack_twin_reset_stats(rack_twin* tp);
+
+/**
+ * This function returns the angle, in degrees, between where the solar
+ * panels of the rack_twin provided to it are pointing and the sun, or a
+ * negative number if the sun has set.
+ */
+double rack_twin_aim_error(rack_twin t);
+
+/**
+ * This function stores where the axes of the rack_twin provided to it
+ * really are, in degrees.
+ */
+void rack_twin_get_angles(rack_twin t, double* x, double* z);
+
+#endif
@@ -0,0 +1,211 @@
+/**
+ * record_ring.c
+ *
+ * This file contains the internal data-structure and function definitions
+ * for the record_ring type.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#include "record_ring.h"
+
+/**
+ * This is the start of a slot of a record ring, which its record follows.
+ * Its sequence number says whether the slot is free for the record with
+ * the same position, or holds the record before it.
+ */
+typedef struct {
+    _Atomic uint64_t sequence;  /* The sequence number of the slot. */
+} record_slot;
+
+/**
+ * This is the data-structure of the record_ring type. Any thread can put
+ * records in the ring by claiming the position at its head, while the
+ * writer takes them from its tail.
+ */
+struct record_ring_data {
+    unsigned char* slots;           /* The slots. */
+    size_t capacity;                /* The number of slots. */
+    size_t record_size;             /* The size of a record. */
+    size_t slot_size;               /* The size of a slot and its record. */
+    _Atomic uint64_t head;          /* The next position to claim. */
+    uint64_t tail;                  /* The next position to write. */
+    _Atomic uint64_t num_dropped;   /* The records the ring had no room
+                                     * for. */
+    record_writer write;            /* What the records are handed to. */
+    void* arg;                      /* What is handed to it with them. */
+    uint64_t writer_sleep;          /* How long the writer sleeps for when
+                                     * the ring is empty. */
+    atomic_bool writing;            /* Whether the writer should keep
+                                     * going. */
+    pthread_t writer;               /* Writes the ring. */
+};
+
+/**
+ * This function returns the slot of the record ring provided to it at the
+ * position provided to it.
+ */
+record_slot* record_ring_slot(record_ring r, uint64_t pos)
+{
+    return (record_slot*) (r->slots + (pos & (r->capacity - 1))
+                                      * r->slot_size);
+}
+
+/**
+ * This function copies the record provided to it into the record ring
+ * provided to it, or drops it if the ring is full. It returns whether the
+ * record was kept.
+ */
+bool record_ring_put(record_ring r, const void* record)
+{
+    record_slot* slot;  /* The slot claimed for the record. */
+    uint64_t pos;       /* The position claimed. */
+    int64_t diff;       /* How far the slot is from being free for it. */
+
+    pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+    while (true)
+    {
+        slot = record_ring_slot(r, pos);
+        diff = (int64_t) (atomic_load_explicit(&slot->sequence,
+                                               memory_order_acquire) - pos);
+
+        /* The slot is free, so try to claim it. A failed claim reloads the
+         * head. */
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&r->head, &pos,
+                    pos + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+
+        /* The slot still holds a record the writer hasn't written, so the
+         * ring is full. */
+        else if (diff < 0)
+        {
+            atomic_fetch_add(&r->num_dropped, 1);
+            return false;
+        }
+
+        /* Another thread claimed the position first. */
+        else
+            pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+    }
+
+    /* Fill the slot in and hand it to the writer. */
+    memcpy((unsigned char*) slot + sizeof(record_slot), record,
+           r->record_size);
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * This function hands every record in the record ring provided to it that
+ * is ready to the writer's function. It returns the number of records
+ * written.
+ */
+size_t record_ring_drain(record_ring r)
+{
+    record_slot* slot;  /* The slot at the tail. */
+    size_t n = 0;       /* The records written. */
+
+    while (true)
+    {
+        slot = record_ring_slot(r, r->tail);
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire)
+            != r->tail + 1)
+            break;
+        r->write((unsigned char*) slot + sizeof(record_slot), r->arg);
+        atomic_store_explicit(&slot->sequence, r->tail + r->capacity,
+                              memory_order_release);
+        r->tail++;
+        n++;
+    }
+    return n;
+}
+
+/**
+ * This function is run by the writer thread of the record ring provided to
+ * it. It writes the ring, sleeping whenever the ring is empty.
+ */
+void* record_ring_write(void* arg)
+{
+    record_ring r = (record_ring) arg;  /* The ring. */
+    struct timespec nap;                /* The sleep. */
+
+    nap.tv_sec = r->writer_sleep / NANOS_PER_SEC;
+    nap.tv_nsec = r->writer_sleep % NANOS_PER_SEC;
+    while (atomic_load(&r->writing))
+    {
+        if (record_ring_drain(r) == 0)
+        {
+            r->write(NULL, r->arg);
+            nanosleep(&nap, NULL);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * This function initialises the record ring provided to it, with room for
+ * capacity records of record_size bytes, and starts its writer.
+ */
+void record_ring_init(record_ring* rp, size_t capacity, size_t record_size,
+                      uint64_t writer_sleep, record_writer write, void* arg)
+{
+    uint64_t pos;
+
+    /* Allocate memory to the record ring, with every record aligned for
+     * anything it could hold. */
+    *rp = (record_ring) malloc(sizeof(struct record_ring_data));
+    (*rp)->capacity = capacity;
+    (*rp)->record_size = record_size;
+    (*rp)->slot_size = (sizeof(record_slot) + record_size
+                        + _Alignof(max_align_t) - 1)
+                       / _Alignof(max_align_t) * _Alignof(max_align_t);
+    (*rp)->slots = (unsigned char*) aligned_alloc(_Alignof(max_align_t),
+                                                  capacity
+                                                  * (*rp)->slot_size);
+
+    /* Start with every slot free for its first record. */
+    for (pos = 0; pos < capacity; pos++)
+        atomic_init(&record_ring_slot(*rp, pos)->sequence, pos);
+    atomic_init(&(*rp)->head, 0);
+    (*rp)->tail = 0;
+    atomic_init(&(*rp)->num_dropped, 0);
+    (*rp)->write = write;
+    (*rp)->arg = arg;
+    (*rp)->writer_sleep = writer_sleep;
+
+    /* Start the writer. */
+    atomic_init(&(*rp)->writing, true);
+    pthread_create(&(*rp)->writer, NULL, record_ring_write, *rp);
+}
+
+/**
+ * This function stops the writer of the record ring provided to it, hands
+ * every record still in it to the writer's function and terminates it.
+ */
+void record_ring_term(record_ring* rp)
+{
+    /* Stop the writer, then write whatever it left behind. Records that
+     * were being put in as it stopped are waited for. */
+    atomic_store(&(*rp)->writing, false);
+    pthread_join((*rp)->writer, NULL);
+    while ((*rp)->tail < atomic_load(&(*rp)->head))
+        record_ring_drain(*rp);
+    (*rp)->write(NULL, (*rp)->arg);
+
+    /* De-allocate memory from the record ring. */
+    free((*rp)->slots);
+    free(*rp);
+}
+
+/**
+ * This function returns how many records the record ring provided to it
+ * had no room for.
+ */
+uint64_t record_ring_get_num_dropped(record_ring r)
+{
+    return atomic_load(&r->num_dropped);
+}
@@ -0,0 +1,77 @@
+/**
+ * record_ring.h
+ *
+ * This file contains the public data-structure and function prototype
+ * declarations for the record_ring type, a bounded lock-free queue that
+ * carries fixed-size records from any number of threads to a background
+ * writer thread.
+ *
+ * Putting a record in the ring never waits, so it can be done from any
+ * thread. If the ring is ever full, the record is dropped and counted
+ * rather than holding the thread up. The writer hands every record, in the
+ * order its position was claimed, to the function the ring was initialised
+ * with.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#ifndef record_ring_h
+#define record_ring_h
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "mycutils.h"
+
+/**
+ * This is the type of function a record ring's writer hands its records
+ * to, along with the argument the ring was initialised with. It is handed
+ * no record, NULL, whenever the ring has been emptied, so whatever it
+ * writes to can be flushed.
+ */
+typedef void (*record_writer)(void* record, void* arg);
+
+/**
+ * This is the data-structure of the record_ring type.
+ */
+typedef struct record_ring_data* record_ring;
+
+/**
+ * This function initialises the record ring provided to it, with room for
+ * capacity records of record_size bytes, and starts its writer. capacity
+ * must be a power of two. The writer hands records to write along with
+ * arg, and sleeps for writer_sleep nano-seconds whenever the ring is
+ * empty.
+ */
+void record_ring_init(record_ring* rp, size_t capacity, size_t record_size,
+                      uint64_t writer_sleep, record_writer write, void* arg);
+
+/**
+ * This function stops the writer of the record ring provided to it, hands
+ * every record still in it to the writer's function and terminates it. It
+ * must only be called once no other thread is putting records in it.
+ */
+void record_ring_term(record_ring* rp);
+
+/**
+ * This function copies the record provided to it into the record ring
+ * provided to it, or drops it if the ring is full. It returns whether the
+ * record was kept.
+ */
+bool record_ring_put(record_ring r, const void* record);
+
+/**
+ * This function returns how many records the record ring provided to it
+ * had no room for.
+ */
+uint64_t record_ring_get_num_dropped(record_ring r);
+
+#endif
@@ -10,6 +10,24 @@
 
 #include "rover.h"
 
+/**
+ * These are the subsystems that are each updated on their own thread.
+ */
+enum Subsystem { INTERFACE_SUBSYSTEM, DRIVE_SUBSYSTEM, RACK_SUBSYSTEM,
+                 NUM_SUBSYSTEMS };
+
+/**
+ * This is a thread that updates one of the rover's subsystems once every
+ * frame.
+ */
+typedef struct {
+    struct rover_data* r;       /* The rover the subsystem belongs to. */
+    void (*tick)(struct rover_data*);   /* Updates the subsystem. */
+    char* name;                 /* The name of the subsystem. */
+    enum Phase phase;           /* The phase its updates are timed as. */
+    pthread_t thread;           /* The thread. */
+} subsystem_worker;
+
 /**
  * This is the internal data of the rover data-type.
  */
@@ -17,21 +35,222 @@ struct rover_data {
     interface i;            /* Allows a user to control the rover. */
     drive d;                /* Controls the movement of the driving motors. */
     rack r;                 /* Controls the movement of the rack motors. */
+    command_ring commands;  /* The user's commands, waiting to run. */
+    estop e;                /* Stops the motors as soon as a stop key is
+                             * pressed. */
+    rack_twin twin;         /* Simulates the rack when the pins are
+                             * simulated, or NULL. */
+    phase_stats stats;      /* How long each phase of the frames took. */
     bool is_running;        /* Whether the rover is running. */
+
+    /* These are the commands the subsystems are executing this frame. */
+    commands cmds;
+
+    /* These are the threads that update the subsystems. Every frame they
+     * all wait at tick_start until the commands are ready, then at
+     * tick_done until every subsystem has finished, so each frame sees the
+     * same state whatever order the threads run in. */
+    subsystem_worker workers[NUM_SUBSYSTEMS];
+    pthread_barrier_t tick_start;
+    pthread_barrier_t tick_done;
+    bool workers_running;   /* Whether the workers should keep going. */
 };
 
 /**
- * This function initialises the rover supplied to it.
+ * This function updates the interface of the rover provided to it.
+ */
+void interface_tick(rover r)
+{
+    uint64_t start = monotonic_nanos();    /* When the update started. */
+
+    LOG_DEBUG("interface_update");
+    interface_update(&r->i, r->cmds.interface_command);
+    phase_stats_record(&r->stats, INTERFACE_UPDATE_PHASE, start);
+}
+
+/**
+ * This function updates the drive of the rover provided to it.
+ */
+void drive_tick(rover r)
+{
+    uint64_t start = monotonic_nanos();    /* When the update started. */
+
+    LOG_DEBUG("drive_update");
+    drive_update(&r->d, r->cmds.drive_command);
+    phase_stats_record(&r->stats, DRIVE_UPDATE_PHASE, start);
+}
+
+/**
+ * This function updates the rack of the rover provided to it.
+ */
+void rack_tick(rover r)
+{
+    bool was_searching;     /* Whether a light search was running. */
+    uint64_t start;         /* When the update started. */
+    int position, num_positions;
+
+    LOG_DEBUG("rack_update");
+    was_searching = rack_get_search_stage(r->r, &position, &num_positions)
+                    != SEARCH_IDLE;
+    start = monotonic_nanos();
+    rack_update(&r->r, r->cmds.rack_command);
+    phase_stats_record(&r->stats, RACK_UPDATE_PHASE, start);
+
+    /* The simulated arduino starts a new series of readings with every
+     * light search. */
+    if (r->twin != NULL && !was_searching
+        && rack_get_search_stage(r->r, &position, &num_positions)
+           != SEARCH_IDLE)
+        rack_twin_new_series(&r->twin);
+}
+
+/**
+ * This function is run by the thread of the subsystem worker provided to
+ * it. It updates the subsystem once every frame.
  */
-void rover_init(rover* rp)
+void* subsystem_run(void* arg)
 {
+    subsystem_worker* w;        /* The worker. */
+
+    w = (subsystem_worker*) arg;
+    while (true)
+    {
+        /* Wait for the frame's commands. */
+        pthread_barrier_wait(&w->r->tick_start);
+        if (!w->r->workers_running)
+            break;
+
+        /* Update the subsystem, which times itself. */
+        w->tick(w->r);
+
+        /* Wait for the other subsystems to finish. */
+        pthread_barrier_wait(&w->r->tick_done);
+    }
+
+    return NULL;
+}
+
+/**
+ * This function starts a thread for each subsystem of the rover provided
+ * to it.
+ */
+void start_workers(rover* rp)
+{
+    subsystem_worker* w;    /* The worker being started. */
+    char* tstamp;           /* A time stamp. */
+    int s;
+
+    /* The frame loop waits at the barriers too. */
+    pthread_barrier_init(&(*rp)->tick_start, NULL, NUM_SUBSYSTEMS + 1);
+    pthread_barrier_init(&(*rp)->tick_done, NULL, NUM_SUBSYSTEMS + 1);
+    (*rp)->workers_running = true;
+
+    (*rp)->workers[INTERFACE_SUBSYSTEM].tick = interface_tick;
+    (*rp)->workers[INTERFACE_SUBSYSTEM].name = "interface";
+    (*rp)->workers[INTERFACE_SUBSYSTEM].phase = INTERFACE_UPDATE_PHASE;
+    (*rp)->workers[DRIVE_SUBSYSTEM].tick = drive_tick;
+    (*rp)->workers[DRIVE_SUBSYSTEM].name = "drive";
+    (*rp)->workers[DRIVE_SUBSYSTEM].phase = DRIVE_UPDATE_PHASE;
+    (*rp)->workers[RACK_SUBSYSTEM].tick = rack_tick;
+    (*rp)->workers[RACK_SUBSYSTEM].name = "rack";
+    (*rp)->workers[RACK_SUBSYSTEM].phase = RACK_UPDATE_PHASE;
+
+    for (s = 0; s < NUM_SUBSYSTEMS; s++)
+    {
+        w = &(*rp)->workers[s];
+        w->r = *rp;
+        if (pthread_create(&w->thread, NULL, subsystem_run, w) != 0)
+        {
+            fprintf(stderr,
+                    "[ %s ] ERROR: In function start_workers(): "
+                    "Could not start the %s thread\n",
+                    (tstamp = timestamp()), w->name);
+            free(tstamp);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/**
+ * This function stops the subsystem threads of the rover provided to it
+ * and reports how long their updates took.
+ */
+void stop_workers(rover* rp)
+{
+    subsystem_worker* w;    /* The worker being stopped. */
+    phase_summary sum;      /* How long its updates took. */
+    int s;
+
+    /* Release the workers from the start barrier without any commands. */
+    (*rp)->workers_running = false;
+    pthread_barrier_wait(&(*rp)->tick_start);
+
+    for (s = 0; s < NUM_SUBSYSTEMS; s++)
+    {
+        w = &(*rp)->workers[s];
+        pthread_join(w->thread, NULL);
+        sum = phase_stats_summarise((*rp)->stats, w->phase);
+        fprintf(stdout, " - The %s updated %llu times, "
+                        "p50 %.3f ms, p99 %.3f ms, worst %.3f ms\n",
+                w->name, (unsigned long long) sum.count, sum.p50 / 1e6,
+                sum.p99 / 1e6, sum.max / 1e6);
+    }
+
+    pthread_barrier_destroy(&(*rp)->tick_start);
+    pthread_barrier_destroy(&(*rp)->tick_done);
+}
+
+/**
+ * This function initialises the rover supplied to it with the options
+ * supplied to it.
+ */
+void rover_init(rover* rp, rover_options opts)
+{
+    /* Start logging before anything else, so everything can log. */
+    logger_start(ROVER_LOG_FILE);
+
     /* Allocate memory to the rover. */
     fprintf(stdout, " - Allocating memory...\n");
     *rp = (rover) malloc(sizeof(struct rover_data));
 
-    /* Set up pi-gpio. */
-    fprintf(stdout, " - Setting up pi-gpio...\n");
-    setup();
+    /* Set up the gpio pins, simulating them if asked to or if there is no
+     * pi-gpio. */
+    if (gpio_pi_backend() == NULL || opts.sim || opts.replay_file != NULL
+        || (getenv(ROVER_GPIO_ENV) != NULL
+            && strcmp(getenv(ROVER_GPIO_ENV), "sim") == 0))
+        gpio_select(gpio_sim_backend());
+    else
+        gpio_select(gpio_pi_backend());
+    fprintf(stdout, " - Setting up %s gpio...\n", gpio_get_backend()->name);
+
+    /* Run the timers on the virtual clock if asked to. */
+    if (opts.virtual_clock || opts.replay_file != NULL
+        || (getenv(ROVER_CLOCK_ENV) != NULL
+            && strcmp(getenv(ROVER_CLOCK_ENV), "virtual") == 0))
+    {
+        fprintf(stdout, " - Running on the virtual clock...\n");
+        use_clock(VIRTUAL_CLOCK);
+    }
+
+    /* Record or replay everything that comes into the rover. */
+    if (opts.replay_file != NULL)
+    {
+        fprintf(stdout, " - Replaying %s...\n", opts.replay_file);
+        trace_start_replay(opts.replay_file, opts.speed);
+        set_timer_hook(trace_timer);
+    }
+    else if (opts.record_file != NULL)
+    {
+        fprintf(stdout, " - Recording to %s...\n", opts.record_file);
+        trace_start_recording(opts.record_file);
+        set_timer_hook(trace_timer);
+    }
+    gpio_setup();
+
+    /* Simulate the rack and the sky behind the simulated pins. */
+    (*rp)->twin = NULL;
+    if (gpio_get_backend() == gpio_sim_backend())
+        rack_twin_init(&(*rp)->twin, RACK_TWIN_DEFAULT_CONFIG);
 
     /* Initialise rover properties. */
     fprintf(stdout, " - Setting up the interface...\n");
@@ -40,6 +259,13 @@ void rover_init(rover* rp)
     drive_init(&(*rp)->d);
     fprintf(stdout, " - Setting up the rack...\n");
     rack_init(&(*rp)->r);
+    rack_set_frame_time(&(*rp)->r, NANOS_PER_FRAME);
+    fprintf(stdout, " - Starting the input watcher...\n");
+    command_ring_init(&(*rp)->commands);
+    estop_init(&(*rp)->e, &(*rp)->commands, drive_halt, &(*rp)->d);
+    fprintf(stdout, " - Starting the subsystem threads...\n");
+    phase_stats_init(&(*rp)->stats);
+    start_workers(rp);
     (*rp)->is_running = true;
 }
 
@@ -48,17 +274,47 @@ void rover_init(rover* rp)
  */
 void rover_term(rover* rp)
 {
+    unsigned num_stops;     /* The number of emergency stops. */
+    uint64_t last_latency;  /* How long the last stop took. */
+    uint64_t worst_latency; /* How long the slowest stop took. */
+
+    /* Stop the subsystem threads. */
+    fprintf(stdout, " - Stopping the subsystem threads...\n");
+    stop_workers(rp);
+
+    /* Write out how long each phase of the frames took. */
+    fprintf(stdout, " - Writing the phase stats to %s...\n",
+            ROVER_PHASE_STATS_FILE);
+    phase_stats_dump((*rp)->stats, ROVER_PHASE_STATS_FILE);
+    phase_stats_term(&(*rp)->stats);
+
+    /* Report how quickly the motors were stopped. */
+    num_stops = estop_get_latency((*rp)->e, &last_latency, &worst_latency);
+    fprintf(stdout, " - Emergency stops: %u, last %.3f ms, worst %.3f ms\n",
+            num_stops, last_latency / 1e6, worst_latency / 1e6);
+
     /* Terminate the rover properties. */
+    fprintf(stdout, " - Stopping the input watcher...\n");
+    estop_term(&(*rp)->e);
+    command_ring_print_stats((*rp)->commands, stdout);
+    command_ring_term(&(*rp)->commands);
+    set_timer_hook(NULL);
+    trace_stop(stdout);
     fprintf(stdout, " - Terminating the rack...\n");
     rack_term(&(*rp)->r);
     fprintf(stdout, " - Terminating the drive...\n");
     drive_term(&(*rp)->d);
     fprintf(stdout, " - Terminating the interface...\n");
     interface_term(&(*rp)->i);
+    if ((*rp)->twin != NULL)
+        rack_twin_term(&(*rp)->twin);
 
     /* De-allocate memory from the rover. */
     fprintf(stdout, " - De-allocating memory...\n");
     free(*rp);
+
+    /* Stop logging once nothing else can log. */
+    logger_stop();
 }
 
 /**
@@ -66,28 +322,51 @@ void rover_term(rover* rp)
  */
 void update(rover* rp)
 {
-    commands cmds;  /* Commands for the rover to execute. */
-    char user_in;   /* The user input. */
+    char live_in;       /* The user input from the keyboard. */
+    char user_in;       /* The user input. */
+    command_record rec; /* The queued command the user input came from. */
+    uint64_t start;     /* When a phase started. */
+
+    /* Start the frame, stopping if a replay has run out of frames. */
+    if (!trace_frame())
+    {
+        (*rp)->is_running = false;
+        return;
+    }
     
-    /* Get user input. */
-    user_in = interface_get_user_in();
+    /* Get user input, which comes from the trace while replaying. */
+    start = monotonic_nanos();
+    live_in = interface_get_user_in(&(*rp)->commands, &rec);
+    phase_stats_record(&(*rp)->stats, GET_USER_IN_PHASE, start);
+    user_in = trace_command(live_in);
     
     /* Build a set of commands. */
-    interface_build_commands(&(*rp)->i, &cmds, user_in);
+    start = monotonic_nanos();
+    interface_build_commands(&(*rp)->i, &(*rp)->cmds, user_in);
+    phase_stats_record(&(*rp)->stats, BUILD_COMMANDS_PHASE, start);
+
+    /* If the input watcher halted the rover, finish stopping it here and
+     * let motions start again. */
+    if (trace_halt(estop_take()))
+    {
+        (*rp)->cmds.drive_command = STOP_DRIVE;
+        (*rp)->cmds.rack_command = CANCEL_LIGHT_SEARCH;
+    }
 
-    /* Update the interface. */
-    fprintf(stdout, " - Updating the interface...\n");
-    interface_update(&(*rp)->i, cmds.interface_command);
+    /* Update the interface, drive and rack at the same time, and wait for
+     * all of them to finish. */
+    pthread_barrier_wait(&(*rp)->tick_start);
+    pthread_barrier_wait(&(*rp)->tick_done);
 
-    /* Update the drive. */
-    fprintf(stdout, " - Updating the drive...\n");
-    drive_update(&(*rp)->d, cmds.drive_command);
+    /* Record how long the user's command waited to run. */
+    if (live_in != 0)
+        command_ring_record_latency(&(*rp)->commands, rec);
 
-    /* Update the rack. */
-    fprintf(stdout, " - Updating the rack...\n");
-    rack_update(&(*rp)->r, cmds.rack_command);
+    /* Quitting stops the motors except on the rack screen, where it only
+     * changes the screen. */
+    estop_arm_quit(&(*rp)->e, !interface_is_rack_screen_on((*rp)->i));
 
-    switch (cmds.interface_command)
+    switch ((*rp)->cmds.interface_command)
     {
         case TERMINATE :
             (*rp)->is_running = false;
@@ -97,9 +376,26 @@ void update(rover* rp)
 
 void display(rover r)
 {
+    uint64_t start;     /* When the drawing started. */
+
     /* Display the interface. */
-    fprintf(stdout, " - Drawing the interface...\n");
-    interface_display(r->i, r->d, r->r);
+    LOG_DEBUG("interface_display");
+    start = monotonic_nanos();
+    interface_display(r->i, r->d, r->r, r->stats);
+    phase_stats_record(&r->stats, DISPLAY_PHASE, start);
+}
+
+/**
+ * This function runs one frame of the rover supplied to it, updating it and
+ * then displaying it.
+ */
+void rover_frame(rover* rp)
+{
+    /* Update the rover. */
+    update(rp);
+
+    /* Display the rover. */
+    display(*rp);
 }
 
 /**
@@ -115,23 +411,19 @@ void rover_exec(rover* rp)
 
     /* Draw the interface in its initial state. */
     fprintf(stdout, " - Drawing the interface in its initial state...\n");
-    interface_display((*rp)->i, (*rp)->d, (*rp)->r);
+    interface_display((*rp)->i, (*rp)->d, (*rp)->r, (*rp)->stats);
 
     /* Check if the rover is still running. */
     while((*rp)->is_running)
     {
-        /* Check if it's time to run a frame. */
-        if (check_timer(end_last_frame, NANOS_PER_FRAME))
-        {
-            /* Update the rover. */
-            update(rp);
+        /* Wait until it's time to run a frame. */
+        wait_timer(end_last_frame, NANOS_PER_FRAME);
 
-            /* Display the rover. */
-            display(*rp);
+        /* Update and display the rover. */
+        rover_frame(rp);
 
-            /* Storing the time. */
-            start_timer(&end_last_frame);
-        }
+        /* Storing the time. */
+        start_timer(&end_last_frame);
     }
 }
 
@@ -14,30 +14,76 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <time.h>
+#include <pthread.h>
 
 #include "interface.h"
 #include "drive.h"
 #include "rack.h"
 #include "mycutils.h"
+#include "gpio.h"
+#include "gpio_sim.h"
+#include "rack_twin.h"
+#include "trace.h"
+#include "logger.h"
+
+/* This is the environment variable that selects the gpio backend. Setting
+ * it to "sim" simulates the pins. */
+#define ROVER_GPIO_ENV "ROVER_GPIO"
+
+/* This is the environment variable that selects the clock. Setting it to
+ * "virtual" runs every timer on the virtual clock, so the rover runs as
+ * fast as it can rather than in real time. */
+#define ROVER_CLOCK_ENV "ROVER_CLOCK"
+
+/* This is the file the rover logs to. */
+#define ROVER_LOG_FILE "../../rover.log"
+
+/* This is the file how long each phase of the frames took is written to
+ * when the rover stops. */
+#define ROVER_PHASE_STATS_FILE "../../phase_stats.txt"
 
 #define FRAMES_PER_SEC 2
 #define NANOS_PER_FRAME NANOS_PER_SEC / FRAMES_PER_SEC
 
+/**
+ * These are the options the rover can be run with.
+ */
+typedef struct {
+    bool sim;           /* Whether to simulate the gpio pins. */
+    bool virtual_clock; /* Whether to run the timers on the virtual clock. */
+    char* record_file;  /* The file to record a trace to, or NULL. */
+    char* replay_file;  /* The file to replay a trace from, or NULL. */
+    double speed;       /* How fast to replay the trace, where 0 is as fast
+                         * as possible. */
+} rover_options;
+
+/* These are the options of a rover run on the pi in real time. */
+#define ROVER_DEFAULT_OPTIONS \
+    ((rover_options) { false, false, NULL, NULL, 1 })
+
 /**
  * This is the rover data-type.
  */
 typedef struct rover_data* rover;
 
 /**
- * This function initialises the rover supplied to it.
+ * This function initialises the rover supplied to it with the options
+ * supplied to it. Replaying a trace always simulates the gpio pins and
+ * runs on the virtual clock.
  */
-void rover_init(rover* rp);
+void rover_init(rover* rp, rover_options opts);
 
 /**
  * This function terminates the rover supplied to it.
  */
 void rover_term(rover* rp);
 
+/**
+ * This function runs one frame of the rover supplied to it, updating it and
+ * then displaying it, without waiting for the frame to be due.
+ */
+void rover_frame(rover* rp);
+
 /**
  * This function runs the rover supplied to it.
  */
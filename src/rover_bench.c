@@ -0,0 +1,295 @@
+/**
+ * rover_bench.c
+ *
+ * This file contains the main function for the rover's micro-benchmarks.
+ * It times the rover's hot paths on the simulated gpio pins, from single
+ * string functions up to a whole frame, and prints one tab separated line
+ * per benchmark so the results can be compared from one build to the next.
+ *
+ * It can be run with these arguments:
+ *   rover_bench.run [runs] [milliseconds per run]
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "rover.h"
+#include "rack.h"
+#include "stepper_motor.h"
+#include "button.h"
+#include "gpio.h"
+#include "gpio_sim.h"
+#include "mycutils.h"
+
+/* These are the files the rack keeps its journal and light map in while it
+ * is benchmarked, so the rover's own are left alone. */
+#define BENCH_JOURNAL "../../rover_bench.journal"
+#define BENCH_LIGHT_MAP "../../rover_bench_light_map.bin"
+
+/* This is the number of times each benchmark is run if none is given. */
+#define BENCH_RUNS 5
+
+/* This is the time, in milli-seconds, each run of a benchmark lasts for
+ * if none is given. */
+#define BENCH_RUN_MILLIS 200
+
+/* This is the most times a benchmark is repeated in one run. */
+#define BENCH_MAX_ITERATIONS 10000000
+
+/* This is the size of the terminal the rover is drawn on, which is fixed
+ * so the results don't depend on the terminal they are run in. */
+#define BENCH_COLUMNS "120"
+#define BENCH_LINES "40"
+
+/* This is the most positions a light search of the benchmarked rack can
+ * visit. */
+#define BENCH_MAX_POSITIONS 64
+
+/**
+ * This is what the benchmarks work on.
+ */
+typedef struct {
+    rover r;                /* The rover, for whole frames. */
+    rack k;                 /* A rack, for planning searches. */
+    stepper_motor m;        /* A stepper motor, for its phases. */
+    button b;               /* A button, for debouncing. */
+    int phase;              /* The phase the motor is in. */
+    int xs[BENCH_MAX_POSITIONS];    /* The x axis of a planned search. */
+    int zs[BENCH_MAX_POSITIONS];    /* The z axis of a planned search. */
+} bench_state;
+
+/**
+ * This is a benchmark.
+ */
+typedef struct {
+    char* name;                     /* The name of the benchmark. */
+    void (*run)(bench_state* s);    /* Does what is benchmarked once. */
+} benchmark;
+
+/**
+ * This function formats a string the way the interface does.
+ */
+void bench_strfmt(bench_state* s)
+{
+    char* str;  /* The formatted string. */
+
+    strfmt(&str, "X: %d degrees, Z: %d degrees, %s", 25, -90, "searching");
+    free(str);
+}
+
+/**
+ * This function removes the spaces from a string.
+ */
+void bench_sdelchar(bench_state* s)
+{
+    char* str;  /* The string. */
+
+    strfmt(&str, "%s", "  The  rack  is  searching  for  light  ");
+    sdelchar(&str, ' ');
+    free(str);
+}
+
+/**
+ * This function moves the terminal cursor.
+ */
+void bench_put_cursor(bench_state* s)
+{
+    put_cursor(10, 5);
+}
+
+/**
+ * This function prints a string on the terminal.
+ */
+void bench_print_str(bench_state* s)
+{
+    print_str("Searching for light", (vec2d) { 10, 5 });
+}
+
+/**
+ * This function gets the size of the terminal.
+ */
+void bench_get_res(bench_state* s)
+{
+    get_res();
+}
+
+/**
+ * This function plans the order a light search visits its positions in,
+ * which finds the closest position once per position.
+ */
+void bench_get_closest_position(bench_state* s)
+{
+    rack_plan_search(&s->k, 0, 0, s->xs, s->zs);
+}
+
+/**
+ * This function moves the stepper motor to its next phase.
+ */
+void bench_step_motor(bench_state* s)
+{
+    step_motor(&s->m, s->phase);
+    s->phase = (s->phase + 1) % 4;
+}
+
+/**
+ * This function debounces the limit switch.
+ */
+void bench_button_update(bench_state* s)
+{
+    button_update(&s->b);
+}
+
+/**
+ * This function updates and displays the whole rover.
+ */
+void bench_frame(bench_state* s)
+{
+    rover_frame(&s->r);
+}
+
+/**
+ * These are the benchmarks, in the order they are run.
+ */
+benchmark benchmarks[] = {
+    { "strfmt", bench_strfmt },
+    { "sdelchar", bench_sdelchar },
+    { "put_cursor", bench_put_cursor },
+    { "print_str", bench_print_str },
+    { "get_res", bench_get_res },
+    { "get_closest_position", bench_get_closest_position },
+    { "step_motor", bench_step_motor },
+    { "button_update", bench_button_update },
+    { "frame", bench_frame }
+};
+
+/**
+ * This function compares two times for qsort().
+ */
+int bench_compare(const void* a, const void* b)
+{
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * This function runs the benchmark provided to it, and prints the
+ * nano-seconds it took each time it was repeated on the file stream
+ * provided to it.
+ */
+void bench_run(FILE* fs, benchmark bm, bench_state* s, int runs,
+               uint64_t run_time)
+{
+    double* times;      /* The nano-seconds per repeat of every run. */
+    uint64_t start;     /* When the run started. */
+    uint64_t elapsed;   /* The nano-seconds the repeats took. */
+    long iterations;    /* The repeats in each run. */
+    long i;
+    int r;
+
+    /* Double the repeats until they take a tenth of a run, then work out
+     * how many fit into a whole run. */
+    iterations = 1;
+    while (true)
+    {
+        start = monotonic_nanos();
+        for (i = 0; i < iterations; i++)
+            bm.run(s);
+        elapsed = monotonic_nanos() - start;
+        if (elapsed >= run_time / 10 || iterations >= BENCH_MAX_ITERATIONS)
+            break;
+        iterations *= 2;
+    }
+    iterations = elapsed == 0 ? BENCH_MAX_ITERATIONS
+                              : (long) (iterations * run_time / elapsed);
+    if (iterations < 1)
+        iterations = 1;
+    if (iterations > BENCH_MAX_ITERATIONS)
+        iterations = BENCH_MAX_ITERATIONS;
+
+    /* Run it. */
+    times = (double*) malloc(sizeof(double) * runs);
+    for (r = 0; r < runs; r++)
+    {
+        start = monotonic_nanos();
+        for (i = 0; i < iterations; i++)
+            bm.run(s);
+        times[r] = (double) (monotonic_nanos() - start) / iterations;
+    }
+
+    /* Print the median, fastest and slowest run. */
+    qsort(times, runs, sizeof(double), bench_compare);
+    fprintf(fs, "%s\t%d\t%ld\t%.1f\t%.1f\t%.1f\n", bm.name, runs, iterations,
+            times[runs / 2], times[0], times[runs - 1]);
+    fflush(fs);
+    free(times);
+}
+
+int main(int argc, char** argv)
+{
+    bench_state s;      /* What the benchmarks work on. */
+    FILE* results;      /* Where the results are printed. */
+    int runs;           /* The times each benchmark is run. */
+    uint64_t run_time;  /* The nano-seconds each run lasts for. */
+    char* tstamp;       /* The time the benchmarks started. */
+    int b;
+
+    runs = argc > 1 ? atoi(argv[1]) : BENCH_RUNS;
+    run_time = (argc > 2 ? atoi(argv[2]) : BENCH_RUN_MILLIS) * 1000000ULL;
+    if (runs < 1)
+        runs = 1;
+
+    /* Print the results where standard output was, and send everything
+     * the rover draws and prints to nowhere. */
+    results = fdopen(dup(STDOUT_FILENO), "w");
+    if (freopen("/dev/null", "w", stdout) == NULL)
+    {
+        fprintf(stderr, "[ %s ] ERROR: In function main(): "
+                        "could not open /dev/null\n",
+                (tstamp = timestamp()));
+        free(tstamp);
+        exit(EXIT_FAILURE);
+    }
+
+    /* Draw on a terminal of the same size every time. */
+    setenv("COLUMNS", BENCH_COLUMNS, 1);
+    setenv("LINES", BENCH_LINES, 1);
+
+    /* Set up the parts on the simulated pins and the virtual clock, so
+     * nothing waits. */
+    gpio_select(gpio_sim_backend());
+    use_clock(VIRTUAL_CLOCK);
+    gpio_setup();
+    rack_init_files(&s.k, BENCH_JOURNAL, BENCH_LIGHT_MAP);
+    stepper_motor_init(&s.m, 2048, RACK_ZMOTOR_PINS);
+    button_init(&s.b, RACK_LIMIT_SWITCH_PIN, 2);
+    s.phase = 0;
+    rover_init(&s.r, (rover_options) { true, true, NULL, NULL, 1 });
+
+    /* Run the benchmarks. */
+    fprintf(results, "# rover_bench %s\n", (tstamp = timestamp()));
+    free(tstamp);
+    fprintf(results, "benchmark\truns\titerations\tmedian_ns\tmin_ns\t"
+                     "max_ns\n");
+    for (b = 0; b < sizeof(benchmarks) / sizeof(benchmark); b++)
+    {
+        fprintf(stderr, " - Running %s...\n", benchmarks[b].name);
+        bench_run(results, benchmarks[b], &s, runs, run_time);
+    }
+
+    /* Clean up. */
+    rover_term(&s.r);
+    button_term(&s.b);
+    stepper_motor_term(&s.m);
+    rack_term(&s.k);
+    remove(BENCH_JOURNAL);
+    remove(BENCH_LIGHT_MAP);
+    fclose(results);
+
+    exit(EXIT_SUCCESS);
+}
@@ -12,8 +12,8 @@
 #define RPIUTILS_H
 
 #include <stdio.h>
-#include <pi-gpio.h>
 
+#include "gpio.h"
 #include "mycutils.h"
 
 /**
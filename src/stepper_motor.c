@@ -45,10 +45,10 @@ void stepper_motor_init(stepper_motor* smp, int num_steps,
     (*smp)->in4_pin = in4_pin;
 
     /* Configure rpi ins so they can communicate with this motor's driver. */
-    setup_gpio((*smp)->in1_pin, OUTPUT, 0);
-    setup_gpio((*smp)->in2_pin, OUTPUT, 0);
-    setup_gpio((*smp)->in3_pin, OUTPUT, 0);
-    setup_gpio((*smp)->in4_pin, OUTPUT, 0);
+    gpio_setup_pin((*smp)->in1_pin, OUTPUT, 0);
+    gpio_setup_pin((*smp)->in2_pin, OUTPUT, 0);
+    gpio_setup_pin((*smp)->in3_pin, OUTPUT, 0);
+    gpio_setup_pin((*smp)->in4_pin, OUTPUT, 0);
 }
 
 void stepper_motor_term(stepper_motor* smp)
@@ -76,36 +76,52 @@ void step_motor(stepper_motor* smp, int this_step)
     switch (this_step) 
     {
         case 0:
-            output_gpio((*smp)->in1_pin, HIGH);
-            output_gpio((*smp)->in2_pin, HIGH);
-            output_gpio((*smp)->in3_pin, LOW);
-            output_gpio((*smp)->in4_pin, LOW);
+            gpio_output((*smp)->in1_pin, HIGH);
+            gpio_output((*smp)->in2_pin, HIGH);
+            gpio_output((*smp)->in3_pin, LOW);
+            gpio_output((*smp)->in4_pin, LOW);
             break;
         case 1:
-            output_gpio((*smp)->in1_pin, LOW);
-            output_gpio((*smp)->in2_pin, HIGH);
-            output_gpio((*smp)->in3_pin, HIGH);
-            output_gpio((*smp)->in4_pin, LOW);
+            gpio_output((*smp)->in1_pin, LOW);
+            gpio_output((*smp)->in2_pin, HIGH);
+            gpio_output((*smp)->in3_pin, HIGH);
+            gpio_output((*smp)->in4_pin, LOW);
             break;
         case 2:
-            output_gpio((*smp)->in1_pin, LOW);
-            output_gpio((*smp)->in2_pin, LOW);
-            output_gpio((*smp)->in3_pin, HIGH);
-            output_gpio((*smp)->in4_pin, HIGH);
+            gpio_output((*smp)->in1_pin, LOW);
+            gpio_output((*smp)->in2_pin, LOW);
+            gpio_output((*smp)->in3_pin, HIGH);
+            gpio_output((*smp)->in4_pin, HIGH);
             break;
         case 3:
-            output_gpio((*smp)->in1_pin, HIGH);
-            output_gpio((*smp)->in2_pin, LOW);
-            output_gpio((*smp)->in3_pin, LOW);
-            output_gpio((*smp)->in4_pin, HIGH);
+            gpio_output((*smp)->in1_pin, HIGH);
+            gpio_output((*smp)->in2_pin, LOW);
+            gpio_output((*smp)->in3_pin, LOW);
+            gpio_output((*smp)->in4_pin, HIGH);
             break;
     }
 }
 
 /**
- * This function rotates the stepper motor provided to it.
+ * This function rotates the stepper motor provided to it, and returns the
+ * number of steps that were taken. Fewer steps than asked for are taken if
+ * the rover is halted.
  */
-void stepper_motor_step(stepper_motor* smp, int num_steps)
+int stepper_motor_step(stepper_motor* smp, int num_steps)
+{
+    return stepper_motor_step_until(smp, num_steps, NULL, NULL);
+}
+
+/**
+ * This function rotates the stepper motor provided to it until either
+ * num_steps steps have been taken or the stop function provided to it
+ * returns true, or the rover is halted. The stop function is called with
+ * arg before every step.
+ * This function returns the number of steps that were taken, which is
+ * negative if num_steps is.
+ */
+int stepper_motor_step_until(stepper_motor* smp, int num_steps,
+                             bool (*stop)(void*), void* arg)
 {
     int steps_left = abs(num_steps);    /* The number of steps left. */
 
@@ -116,32 +132,40 @@ void stepper_motor_step(stepper_motor* smp, int num_steps)
     /* Rotate the motor. */
     while (steps_left > 0)
     {
-        /* Check if enough time has passed between steps. */
-        if (check_timer((*smp)->last_step_time, (*smp)->step_delay))
+        /* Wait until enough time has passed between steps. */
+        wait_timer((*smp)->last_step_time, (*smp)->step_delay);
+
+        /* Check if the motor should stop before this step. */
+        if (estop_is_halted() || (stop != NULL && stop(arg)))
+            break;
+
+        /* Record the time of this step. */
+        start_timer(&(*smp)->last_step_time);
+
+        /* Check which direction the motor should rotate. */
+        if ((*smp)->direction == 1)
         {
-            /* Record the time of this step. */
-            start_timer(&(*smp)->last_step_time);
-
-            /* Check which direction the motor should rotate. */
-            if ((*smp)->direction == 1)
-            {
-                /* Calculate and record the step number. */
-                (*smp)->step_num++;
-                if ((*smp)->step_num == (*smp)->num_steps)
-                    (*smp)->step_num = 1;
-            }
-            else
-            {
-                /* Calculate and record the step number. */
-                if ((*smp)->step_num == 0)
-                    (*smp)->step_num = (*smp)->num_steps;
-                (*smp)->step_num--;
-            }
-            /* Calculate and record how many steps are left. */
-            steps_left--;
-
-            /* Activate the appropriate phase of the stepper_motor. */
-            step_motor(smp, (*smp)->step_num % 4);
-        } 
+            /* Calculate and record the step number. */
+            (*smp)->step_num++;
+            if ((*smp)->step_num == (*smp)->num_steps)
+                (*smp)->step_num = 0;
+        }
+        else
+        {
+            /* Calculate and record the step number. */
+            if ((*smp)->step_num == 0)
+                (*smp)->step_num = (*smp)->num_steps;
+            (*smp)->step_num--;
+        }
+        /* Calculate and record how many steps are left. */
+        steps_left--;
+
+        /* Activate the appropriate phase of the stepper_motor. */
+        step_motor(smp, (*smp)->step_num % 4);
     }
+
+    /* Return the number of steps that were taken. */
+    if (num_steps < 0)
+        return -(abs(num_steps) - steps_left);
+    return num_steps - steps_left;
 }
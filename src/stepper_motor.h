@@ -12,11 +12,13 @@
 #define stepper_motor_h
 
 #include <stdlib.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <time.h>
-#include <pi-gpio.h>
 
+#include "gpio.h"
 #include "mycutils.h"
+#include "estop.h"
 
 /**
  * This is the data-structure of the stepper_motor type.
@@ -42,8 +44,27 @@ void stepper_motor_term(stepper_motor* smp);
 void stepper_motor_steps_per_sec(stepper_motor* smp, unsigned int steps_per_sec);
 
 /**
- * This function rotates the stepper motor provided to it.
+ * This function activates one of the four phases of the stepper_motor
+ * provided to it.
+ */
+void step_motor(stepper_motor* smp, int this_step);
+
+/**
+ * This function rotates the stepper motor provided to it, and returns the
+ * number of steps that were taken. Fewer steps than asked for are taken if
+ * the rover is halted.
+ */
+int stepper_motor_step(stepper_motor* smp, int num_steps);
+
+/**
+ * This function rotates the stepper motor provided to it until either
+ * num_steps steps have been taken or the stop function provided to it
+ * returns true, or the rover is halted. The stop function is called with
+ * arg before every step.
+ * This function returns the number of steps that were taken, which is
+ * negative if num_steps is.
  */
-void stepper_motor_step(stepper_motor* smp, int num_steps);
+int stepper_motor_step_until(stepper_motor* smp, int num_steps,
+                             bool (*stop)(void*), void* arg);
 
 #endif
@@ -0,0 +1,79 @@
+/**
+ * task.h
+ *
+ * This file contains the task type, which lets a long-running behaviour be
+ * written as one linear function that waits at await points, while still
+ * being run a little at a time by repeated calls from the control thread.
+ *
+ * A task function starts with TASK_BEGIN() and ends with TASK_END(). Each
+ * call runs it from the await point it last stopped at until it reaches
+ * another one that isn't satisfied yet. Local variables do not keep their
+ * values across await points, so anything that must survive one belongs
+ * in the state the task works on.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#ifndef task_h
+#define task_h
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "mycutils.h"
+
+/**
+ * These are what a task function returns each time it is called.
+ */
+enum TaskStatus { TASK_WAITING, TASK_DONE };
+
+/**
+ * This is the data-structure of a task.
+ */
+typedef struct {
+    int line;               /* The await point to carry on from, or 0. */
+    struct timespec timer;  /* When the current sleep started. */
+} task;
+
+/* This makes the task provided to it start from the beginning the next
+ * time its function is called. */
+#define TASK_RESET(t) ((t)->line = 0)
+
+/* This starts the body of a task function. */
+#define TASK_BEGIN(t) switch ((t)->line) { case 0 :
+
+/* This ends the body of a task function. */
+#define TASK_END(t) } (t)->line = 0; return TASK_DONE
+
+/* This gives up the rest of this call, carrying on from here next time. */
+#define TASK_YIELD(t)                                                       \
+    do {                                                                    \
+        (t)->line = __LINE__; return TASK_WAITING; case __LINE__ : ;        \
+    } while (0)
+
+/* This waits until the condition provided to it is true. The condition is
+ * checked again on every call. */
+#define TASK_AWAIT(t, cond)                                                 \
+    do {                                                                    \
+        (t)->line = __LINE__; case __LINE__ :                               \
+        if (!(cond)) return TASK_WAITING;                                   \
+    } while (0)
+
+/* This waits until the number of nanoseconds provided to it have
+ * passed. */
+#define TASK_SLEEP(t, nanos)                                                \
+    do {                                                                    \
+        start_timer(&(t)->timer);                                           \
+        TASK_AWAIT(t, check_timer((t)->timer, (nanos)));                    \
+    } while (0)
+
+/* This waits until the call to another task function provided to it
+ * returns TASK_DONE, running that task a little more on every call. */
+#define TASK_AWAIT_TASK(t, call) TASK_AWAIT(t, (call) == TASK_DONE)
+
+/* This starts the task again from the beginning on the next call. */
+#define TASK_RESTART(t) do { (t)->line = 0; return TASK_WAITING; } while (0)
+
+#endif
@@ -0,0 +1,471 @@
+/**
+ * trace.c
+ *
+ * This file contains the internal data-structure and function definitions
+ * for the trace.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#include "trace.h"
+
+/**
+ * This is a stream of records a replay follows, such as the levels of one
+ * pin. Each stream has its own place in the trace.
+ */
+typedef struct {
+    uint16_t event;     /* The kind of record. */
+    bool keyed;         /* Whether the key and value pick the records. */
+    uint16_t key;       /* The key of the records. */
+    uint64_t value;     /* The value of the records, for timers. */
+    size_t next;        /* The place to look for its next record from. */
+} trace_stream;
+
+/**
+ * This is the state of the trace.
+ */
+struct {
+    _Atomic enum TraceMode mode;    /* What the trace is doing. */
+    struct timespec start;          /* When the trace started. */
+
+    /* These are used while recording. Any thread can put records in the
+     * ring, while its writer writes them to the trace file. */
+    record_ring ring;               /* The ring. */
+    uint64_t num_written;           /* The records written. */
+    FILE* fs;                       /* The trace file. */
+
+    /* These are used while replaying. */
+    trace_record* records;          /* Every record of the trace. */
+    size_t num_records;             /* The number of records. */
+    size_t frame;                   /* The place of the current frame. */
+    size_t num_frames;              /* The frames replayed. */
+    trace_stream streams[TRACE_MAX_STREAMS];    /* The streams. */
+    int num_streams;                /* The number of streams. */
+    double speed;                   /* How fast to replay. */
+    uint64_t num_missing;           /* The records that ran out. */
+    uint64_t num_diverged;          /* The readings that didn't match. */
+    pthread_mutex_t lock;           /* Guards the replay's places. */
+} trace_state = { .mode = TRACE_OFF, .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/**
+ * This function prints an error about the trace file provided to it and
+ * exits.
+ */
+void trace_error(char* func, char* msg, char* fname)
+{
+    char* tstamp;   /* The time of the error. */
+
+    fprintf(stderr, "[ %s ] ERROR: In function %s(): %s %s\n",
+            (tstamp = timestamp()), func, msg, fname);
+    free(tstamp);
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * This function returns the nano-seconds since the trace started.
+ */
+uint64_t trace_now()
+{
+    struct timespec now;    /* The current time. */
+
+    get_time(&now);
+    return (uint64_t) (now.tv_sec - trace_state.start.tv_sec) * NANOS_PER_SEC
+        + now.tv_nsec - trace_state.start.tv_nsec;
+}
+
+/**
+ * This function puts a record in the ring, or drops it if the ring is
+ * full. It never waits, so it can be called from any thread.
+ */
+void trace_put(uint16_t event, uint16_t key, uint64_t value, int32_t level)
+{
+    trace_record record = { trace_now(), value, event, key, level };
+
+    record_ring_put(trace_state.ring, &record);
+}
+
+/**
+ * This function is handed the records of the ring by its writer. It writes
+ * the record provided to it to the trace file provided to it, or flushes
+ * the file if there is no record.
+ */
+void trace_write(void* record, void* arg)
+{
+    FILE* fs = (FILE*) arg;     /* The trace file. */
+
+    if (record == NULL)
+        fflush(fs);
+    else
+    {
+        fwrite(record, sizeof(trace_record), 1, fs);
+        trace_state.num_written++;
+    }
+}
+
+/**
+ * This function starts recording to the file provided to it.
+ */
+void trace_start_recording(char* fname)
+{
+    int64_t start_wall;     /* The calendar time the trace started. */
+
+    /* Open the trace file and start it with the calendar time, so the
+     * replay can start at the same time of day. */
+    if ((trace_state.fs = fopen(fname, "wb")) == NULL)
+        trace_error("trace_start_recording", "could not create", fname);
+    start_wall = wall_time();
+    fwrite(TRACE_MAGIC, 1, strlen(TRACE_MAGIC), trace_state.fs);
+    fwrite(&start_wall, sizeof(start_wall), 1, trace_state.fs);
+
+    /* Start the ring writing to it. */
+    trace_state.num_written = 0;
+    get_time(&trace_state.start);
+    record_ring_init(&trace_state.ring, TRACE_RING_CAPACITY,
+                     sizeof(trace_record), TRACE_WRITER_SLEEP, trace_write,
+                     trace_state.fs);
+    atomic_store(&trace_state.mode, TRACE_RECORDING);
+}
+
+/**
+ * This function starts replaying the file provided to it, at the speed
+ * provided to it.
+ */
+void trace_start_replay(char* fname, double speed)
+{
+    char magic[sizeof(TRACE_MAGIC)];    /* The start of the file. */
+    int64_t start_wall;                 /* The calendar time the trace
+                                         * started. */
+    FILE* fs;                           /* The trace file. */
+    long size;                          /* The size of the file. */
+
+    /* Check the file is a trace. */
+    if ((fs = fopen(fname, "rb")) == NULL)
+        trace_error("trace_start_replay", "could not open", fname);
+    if (fread(magic, 1, strlen(TRACE_MAGIC), fs) != strlen(TRACE_MAGIC)
+        || strncmp(magic, TRACE_MAGIC, strlen(TRACE_MAGIC)) != 0
+        || fread(&start_wall, sizeof(start_wall), 1, fs) != 1)
+        trace_error("trace_start_replay", "not a trace file:", fname);
+
+    /* Read every record. */
+    fseek(fs, 0, SEEK_END);
+    size = ftell(fs) - strlen(TRACE_MAGIC) - sizeof(start_wall);
+    fseek(fs, strlen(TRACE_MAGIC) + sizeof(start_wall), SEEK_SET);
+    trace_state.num_records = size / sizeof(trace_record);
+    trace_state.records = (trace_record*) malloc(sizeof(trace_record)
+                                     * (trace_state.num_records + 1));
+    trace_state.num_records = fread(trace_state.records,
+                                    sizeof(trace_record),
+                                    trace_state.num_records, fs);
+    fclose(fs);
+
+    /* Start before the first frame, at the time of day it was
+     * recorded. */
+    trace_state.frame = 0;
+    trace_state.num_frames = 0;
+    trace_state.num_streams = 0;
+    trace_state.num_missing = 0;
+    trace_state.num_diverged = 0;
+    trace_state.speed = speed;
+    set_wall_time(start_wall);
+    clock_gettime(CLOCK_MONOTONIC, &trace_state.start);
+    atomic_store(&trace_state.mode, TRACE_REPLAYING);
+}
+
+/**
+ * This function stops recording or replaying, and prints what happened on
+ * the file stream provided to it.
+ */
+void trace_stop(FILE* fs)
+{
+    uint64_t num_dropped;   /* The records the ring had no room for. */
+
+    switch (atomic_exchange(&trace_state.mode, TRACE_OFF))
+    {
+        case TRACE_RECORDING :
+            /* Write whatever the ring still has. */
+            num_dropped = record_ring_get_num_dropped(trace_state.ring);
+            record_ring_term(&trace_state.ring);
+            fclose(trace_state.fs);
+            fprintf(fs, " - Trace: %lu records written, %lu dropped\n",
+                    (unsigned long) trace_state.num_written,
+                    (unsigned long) num_dropped);
+            break;
+        case TRACE_REPLAYING :
+            free(trace_state.records);
+            fprintf(fs, " - Replay: %lu frames, %lu records missing, "
+                        "%lu readings diverged\n",
+                    (unsigned long) trace_state.num_frames,
+                    (unsigned long) trace_state.num_missing,
+                    (unsigned long) trace_state.num_diverged);
+            break;
+        case TRACE_OFF :
+            NULL;
+            break;
+    }
+}
+
+/**
+ * This function returns what the trace is doing.
+ */
+enum TraceMode trace_get_mode()
+{
+    return atomic_load(&trace_state.mode);
+}
+
+/**
+ * This function returns the place of the next record of the stream
+ * provided to it, moving the stream past it, or -1 if there isn't one. A
+ * keyed stream only has the records of the event with the key and value
+ * provided, and otherwise it has every record of the event. The caller
+ * must hold the replay's lock.
+ */
+long trace_next(uint16_t event, bool keyed, uint16_t key, uint64_t value,
+                bool in_frame)
+{
+    trace_stream* s;    /* The stream. */
+    size_t r;           /* The place of the record being checked. */
+    int i;
+
+    /* Find the stream, starting a new one at the current frame if it
+     * hasn't been followed before. */
+    if (!keyed)
+    {
+        key = 0;
+        value = 0;
+    }
+    for (i = 0; i < trace_state.num_streams; i++)
+    {
+        s = &trace_state.streams[i];
+        if (s->event == event && s->keyed == keyed && s->key == key
+            && s->value == value)
+            break;
+    }
+    if (i == trace_state.num_streams)
+    {
+        if (i == TRACE_MAX_STREAMS)
+            return -1;
+        trace_state.streams[i] = (trace_stream) { event, keyed, key, value,
+                                                  trace_state.frame };
+        trace_state.num_streams++;
+        s = &trace_state.streams[i];
+    }
+
+    /* Frame records are only looked for in the current frame. */
+    if (in_frame && s->next < trace_state.frame)
+        s->next = trace_state.frame + 1;
+
+    /* Find the stream's next record. */
+    for (r = s->next; r < trace_state.num_records; r++)
+    {
+        if (in_frame && trace_state.records[r].event == TRACE_FRAME)
+            break;
+        if (trace_state.records[r].event == event
+            && (!keyed || (trace_state.records[r].key == key
+                           && trace_state.records[r].value == value)))
+        {
+            s->next = r + 1;
+            return r;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * This function marks the start of a frame. While replaying, it waits
+ * until the frame is due and returns false once there are no frames left.
+ */
+bool trace_frame()
+{
+    struct timespec due;    /* When the frame is due. */
+    uint64_t nanos;         /* When it is due, in nano-seconds. */
+    size_t r;               /* The place of the next frame. */
+
+    switch (trace_get_mode())
+    {
+        case TRACE_RECORDING :
+            trace_put(TRACE_FRAME, 0, 0, 0);
+            return true;
+        case TRACE_REPLAYING :
+            /* Find the next frame. */
+            pthread_mutex_lock(&trace_state.lock);
+            r = trace_state.num_frames == 0 ? 0 : trace_state.frame + 1;
+            while (r < trace_state.num_records
+                   && trace_state.records[r].event != TRACE_FRAME)
+                r++;
+            if (r >= trace_state.num_records)
+            {
+                pthread_mutex_unlock(&trace_state.lock);
+                return false;
+            }
+            trace_state.frame = r;
+            trace_state.num_frames++;
+            pthread_mutex_unlock(&trace_state.lock);
+
+            /* Wait until it is due at the speed of the replay. */
+            if (trace_state.speed > 0)
+            {
+                nanos = trace_state.start.tv_sec * (uint64_t) NANOS_PER_SEC
+                    + trace_state.start.tv_nsec
+                    + (uint64_t) (trace_state.records[r].time
+                                  / trace_state.speed);
+                due.tv_sec = nanos / NANOS_PER_SEC;
+                due.tv_nsec = nanos % NANOS_PER_SEC;
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL);
+            }
+            return true;
+        case TRACE_OFF :
+            NULL;
+            break;
+    }
+    return true;
+}
+
+/**
+ * This function records the user's command for the frame, which is 0 if
+ * there wasn't one. While replaying, it returns the recorded command
+ * instead.
+ */
+char trace_command(char key)
+{
+    size_t r;   /* The place of the frame's command. */
+
+    switch (trace_get_mode())
+    {
+        case TRACE_RECORDING :
+            if (key != 0)
+                trace_put(TRACE_COMMAND, (unsigned char) key, 0, 0);
+            return key;
+        case TRACE_REPLAYING :
+            /* Look for a command between this frame and the next. */
+            pthread_mutex_lock(&trace_state.lock);
+            key = 0;
+            for (r = trace_state.frame + 1; r < trace_state.num_records
+                 && trace_state.records[r].event != TRACE_FRAME; r++)
+            {
+                if (trace_state.records[r].event == TRACE_COMMAND)
+                {
+                    key = (char) trace_state.records[r].key;
+                    break;
+                }
+            }
+            pthread_mutex_unlock(&trace_state.lock);
+            return key;
+        case TRACE_OFF :
+            NULL;
+            break;
+    }
+    return key;
+}
+
+/**
+ * This function records whether the frame finished an emergency stop.
+ * While replaying, it returns whether the recorded frame did instead.
+ */
+bool trace_halt(bool halted)
+{
+    switch (trace_get_mode())
+    {
+        case TRACE_RECORDING :
+            if (halted)
+                trace_put(TRACE_HALT, 0, 0, 0);
+            return halted;
+        case TRACE_REPLAYING :
+            pthread_mutex_lock(&trace_state.lock);
+            halted = trace_next(TRACE_HALT, true, 0, 0, true) >= 0;
+            pthread_mutex_unlock(&trace_state.lock);
+            return halted;
+        case TRACE_OFF :
+            NULL;
+            break;
+    }
+    return halted;
+}
+
+/**
+ * This function records the level read from an input pin. While replaying,
+ * it returns the level recorded for the pin instead.
+ */
+int trace_input(int pin, int level)
+{
+    long r;     /* The place of the recorded level. */
+
+    switch (trace_get_mode())
+    {
+        case TRACE_RECORDING :
+            trace_put(TRACE_INPUT, pin, 0, level);
+            return level;
+        case TRACE_REPLAYING :
+            pthread_mutex_lock(&trace_state.lock);
+            if ((r = trace_next(TRACE_INPUT, true, pin, 0, false)) >= 0)
+                level = trace_state.records[r].level;
+            else
+                trace_state.num_missing++;
+            pthread_mutex_unlock(&trace_state.lock);
+            return level;
+        case TRACE_OFF :
+            NULL;
+            break;
+    }
+    return level;
+}
+
+/**
+ * This function records whether a timer of the length provided to it had
+ * elapsed. While replaying, it returns what was recorded for timers of the
+ * same length instead.
+ */
+bool trace_timer(uint64_t wait_time, bool elapsed)
+{
+    long r;     /* The place of the recorded decision. */
+
+    switch (trace_get_mode())
+    {
+        case TRACE_RECORDING :
+            trace_put(TRACE_TIMER, 0, wait_time, elapsed);
+            return elapsed;
+        case TRACE_REPLAYING :
+            pthread_mutex_lock(&trace_state.lock);
+            if ((r = trace_next(TRACE_TIMER, true, 0, wait_time, false)) >= 0)
+                elapsed = trace_state.records[r].level;
+            else
+                trace_state.num_missing++;
+            pthread_mutex_unlock(&trace_state.lock);
+            return elapsed;
+        case TRACE_OFF :
+            NULL;
+            break;
+    }
+    return elapsed;
+}
+
+/**
+ * This function records a reading of the light dependant resistor. While
+ * replaying, it checks the reading is the one that was recorded.
+ */
+void trace_ldr(long x_steps, long z_steps, bool brightest)
+{
+    long r;     /* The place of the recorded reading. */
+
+    switch (trace_get_mode())
+    {
+        case TRACE_RECORDING :
+            trace_put(TRACE_LDR, brightest, (uint64_t) x_steps, z_steps);
+            break;
+        case TRACE_REPLAYING :
+            pthread_mutex_lock(&trace_state.lock);
+            /* The readings are one stream, so every reading is checked
+             * against the next one recorded wherever it was made. */
+            if ((r = trace_next(TRACE_LDR, false, 0, 0, false)) < 0
+                || trace_state.records[r].key != brightest
+                || trace_state.records[r].value != (uint64_t) x_steps
+                || trace_state.records[r].level != z_steps)
+                trace_state.num_diverged++;
+            pthread_mutex_unlock(&trace_state.lock);
+            break;
+        case TRACE_OFF :
+            NULL;
+            break;
+    }
+}
@@ -0,0 +1,149 @@
+/**
+ * trace.h
+ *
+ * This file contains the public data-structure and function prototype
+ * declarations for the trace, as well as enumeration definitions for it.
+ *
+ * The trace records everything that comes into the rover from outside: the
+ * user's commands, the levels read from input pins, the readings of the
+ * light dependant resistor and the decisions of timers. It can then replay
+ * them, so the rover's unchanged control code does exactly what it did
+ * when they were recorded.
+ *
+ * Recording is cheap enough to leave on. Records are put into a lock-free
+ * ring by whichever thread makes them, and a background thread writes them
+ * to the trace file. If the ring is ever full, records are dropped rather
+ * than holding the rover up.
+ *
+ * Version: 1.0.0
+ * Author(s): Richard Gale
+ */
+
+#ifndef trace_h
+#define trace_h
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "mycutils.h"
+#include "record_ring.h"
+
+/* This is the number of records the ring can hold. It must be a power of
+ * two. */
+#define TRACE_RING_CAPACITY 8192
+
+/* This is the time, in nano-seconds, the writer sleeps for when the ring
+ * is empty. */
+#define TRACE_WRITER_SLEEP 10000000
+
+/* This is the number of different streams of records a replay can follow,
+ * such as the levels of one pin or the decisions of timers of one length. */
+#define TRACE_MAX_STREAMS 64
+
+/* This is written at the start of every trace file. */
+#define TRACE_MAGIC "RVTRACE1"
+
+/**
+ * These are the things the trace can be doing.
+ */
+enum TraceMode { TRACE_OFF, TRACE_RECORDING, TRACE_REPLAYING };
+
+/**
+ * These are the kinds of record in a trace.
+ */
+enum TraceEvent {
+    TRACE_FRAME,    /* A frame of the rover started. */
+    TRACE_COMMAND,  /* The user's command for the frame. The key is the
+                     * command. */
+    TRACE_HALT,     /* The frame finished an emergency stop. */
+    TRACE_INPUT,    /* An input pin was read. The key is the pin and the
+                     * level is what was read. */
+    TRACE_TIMER,    /* A timer was checked. The value is its length and the
+                     * level is whether it had elapsed. */
+    TRACE_LDR       /* The light dependant resistor made a reading. The
+                     * value and level are the x and z step positions it
+                     * was tagged with, and the key is whether it was the
+                     * brightest. */
+};
+
+/**
+ * This is a record in a trace.
+ */
+typedef struct {
+    uint64_t time;      /* When it happened, in nano-seconds since the
+                         * trace started. */
+    uint64_t value;     /* The record's value. */
+    uint16_t event;     /* The kind of record. */
+    uint16_t key;       /* The record's key. */
+    int32_t level;      /* The record's level. */
+} trace_record;
+
+/**
+ * This function starts recording to the file provided to it.
+ */
+void trace_start_recording(char* fname);
+
+/**
+ * This function starts replaying the file provided to it, at the speed
+ * provided to it. A speed of 1 replays the frames as far apart as they
+ * were recorded, 2 twice as fast, and 0 as fast as possible. The rover
+ * should be running on the virtual clock, so its own timers don't hold the
+ * replay up.
+ */
+void trace_start_replay(char* fname, double speed);
+
+/**
+ * This function stops recording or replaying, and prints what happened on
+ * the file stream provided to it.
+ */
+void trace_stop(FILE* fs);
+
+/**
+ * This function returns what the trace is doing.
+ */
+enum TraceMode trace_get_mode();
+
+/**
+ * This function marks the start of a frame. While replaying, it waits
+ * until the frame is due and returns false once there are no frames left.
+ */
+bool trace_frame();
+
+/**
+ * This function records the user's command for the frame, which is 0 if
+ * there wasn't one. While replaying, it returns the recorded command
+ * instead.
+ */
+char trace_command(char key);
+
+/**
+ * This function records whether the frame finished an emergency stop.
+ * While replaying, it returns whether the recorded frame did instead.
+ */
+bool trace_halt(bool halted);
+
+/**
+ * This function records the level read from an input pin. While replaying,
+ * it returns the level recorded for the pin instead.
+ */
+int trace_input(int pin, int level);
+
+/**
+ * This function records whether a timer of the length provided to it had
+ * elapsed. While replaying, it returns what was recorded for timers of the
+ * same length instead.
+ */
+bool trace_timer(uint64_t wait_time, bool elapsed);
+
+/**
+ * This function records a reading of the light dependant resistor. While
+ * replaying, it checks the reading is the one that was recorded.
+ */
+void trace_ldr(long x_steps, long z_steps, bool brightest);
+
+#endif